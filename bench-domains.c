@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "csp.h"
+
+// Number of variables and number of values of each domain
+#define VARIABLES 6
+#define VALUES 64
+
+// Compare two values for qsort and bsearch
+int compare_values(const void *a, const void *b) {
+  size_t va = *(const size_t *)a;
+  size_t vb = *(const size_t *)b;
+  return va < vb ? -1 : va > vb;
+}
+
+// Check if the values are different and their sum is not a multiple of 7
+bool compatibles(const CSPConstraint *constraint, const size_t *values,
+                 const void *data) {
+  // Avoid compiler warnings
+  (void)data;
+
+  size_t v0 = values[csp_constraint_get_variable(constraint, 0)];
+  size_t v1 = values[csp_constraint_get_variable(constraint, 1)];
+  return v0 != v1 && (v0 + v1) % 7 != 0;
+}
+
+// Check if the value belongs to the sorted values of the variable
+bool member(const CSPConstraint *constraint, const size_t *values,
+            const void *data) {
+  const size_t(*domains)[VALUES] = data;
+  size_t variable = csp_constraint_get_variable(constraint, 0);
+  return bsearch(&values[variable], domains[variable], VALUES, sizeof(size_t),
+                 compare_values) != NULL;
+}
+
+// Print the usage
+int usage(const char *program) {
+  fprintf(stderr, "Usage: %s <range> sparse|filter <solutions>\n", program);
+  return EXIT_FAILURE;
+}
+
+int main(int argc, char *argv[]) {
+  size_t range, limit;
+  if (argc != 4 || sscanf(argv[1], "%zu", &range) != 1 || !range ||
+      (strcmp(argv[2], "sparse") && strcmp(argv[2], "filter")) ||
+      sscanf(argv[3], "%zu", &limit) != 1) {
+    return usage(argv[0]);
+  }
+  bool sparse = !strcmp(argv[2], "sparse");
+
+  // Draw the values of the domains in [0, range)
+  static size_t domains[VARIABLES][VALUES];
+  srand(1);
+  for (size_t i = 0; i < VARIABLES; i++) {
+    for (size_t k = 0; k < VALUES; k++) {
+      domains[i][k] = ((size_t)rand() * RAND_MAX + (size_t)rand()) % range;
+    }
+    qsort(domains[i], VALUES, sizeof(size_t), compare_values);
+  }
+
+  // Initialise the library
+  csp_init();
+  {
+    // Create the CSP problem: the values are either the domains, or the whole
+    // range filtered by a unary constraint on each variable
+    size_t num_constraints =
+        VARIABLES * (VARIABLES - 1) / 2 + (sparse ? 0 : VARIABLES);
+    CSPProblem *problem = csp_problem_create(VARIABLES, num_constraints);
+    size_t index = 0;
+    for (size_t i = 0; i < VARIABLES; i++) {
+      for (size_t j = i + 1; j < VARIABLES; j++) {
+        CSPConstraint *constraint = csp_constraint_create(2, compatibles);
+        csp_constraint_set_variable(constraint, 0, i);
+        csp_constraint_set_variable(constraint, 1, j);
+        csp_problem_set_constraint(problem, index++, constraint);
+      }
+    }
+    for (size_t i = 0; i < VARIABLES; i++) {
+      if (sparse) {
+        csp_problem_set_domain_values(problem, i, domains[i], VALUES);
+      } else {
+        csp_problem_set_domain(problem, i, range);
+        CSPConstraint *constraint = csp_constraint_create(1, member);
+        csp_constraint_set_variable(constraint, 0, i);
+        csp_problem_set_constraint(problem, index++, constraint);
+      }
+    }
+
+    // Measure the memory allocated for the values of the domains
+    size_t memory = 0;
+    for (size_t i = 0; i < VARIABLES; i++) {
+      memory += csp_problem_get_domain_memory(problem, i);
+    }
+
+    // Stream the first solutions with the cursor
+    size_t values[VARIABLES];
+    size_t count = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    CSPSearch *search = csp_search_begin(problem, domains);
+    if (search != NULL) {
+      while (count < limit && csp_search_next(search, values)) {
+        count++;
+      }
+      csp_search_end(search);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double time = (double)(end.tv_sec - start.tv_sec) +
+                  (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("range: %zu\ndomains: %s\ndomain memory: %zu bytes\n"
+           "solutions: %zu\ntime: %.3f s\nrate: %.0f solutions/s\n",
+           range, argv[2], memory, count, time, (double)count / time);
+
+    // Destroy the CSP problem
+    while (index--) {
+      csp_constraint_destroy(csp_problem_get_constraint(problem, index));
+    }
+    csp_problem_destroy(problem);
+  }
+  // Finish the library
+  csp_finish();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,300 @@
+#include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "csp.h"
+
+/**
+ * @brief An edge of a graph.
+ * @var u The smallest vertex of the edge.
+ * @var v The largest vertex of the edge.
+ */
+typedef struct {
+  size_t u;
+  size_t v;
+} Edge;
+
+// Check if the vertices have different colours
+bool different_colours(const CSPConstraint *constraint, const size_t *values,
+                       const void *data) {
+  // Avoid compiler warnings
+  (void)data;
+
+  return values[csp_constraint_get_variable(constraint, 0)] !=
+         values[csp_constraint_get_variable(constraint, 1)];
+}
+
+// Compare two edges for qsort
+int compare_edges(const void *a, const void *b) {
+  const Edge *ea = a;
+  const Edge *eb = b;
+  if (ea->u != eb->u) {
+    return ea->u < eb->u ? -1 : 1;
+  }
+  return ea->v < eb->v ? -1 : ea->v > eb->v;
+}
+
+// Read an unsigned decimal number after the cursor, failing on a sign or an
+// overflow
+bool read_number(char **cursor, size_t *number) {
+  char *text = *cursor + strspn(*cursor, " \t");
+  if (!isdigit((unsigned char)*text)) {
+    return false;
+  }
+  errno = 0;
+  unsigned long long value = strtoull(text, cursor, 10);
+  if (errno == ERANGE || value > SIZE_MAX) {
+    return false;
+  }
+  *number = (size_t)value;
+  return true;
+}
+
+// Read the edges of a DIMACS graph in one pass ("p edge <vertices> <edges>"
+// then "e <u> <v>" lines with vertices numbered from 1), reporting the
+// errors on the standard error. The edges are stored as they are read, so
+// that the counts of the header are only trusted once matched.
+Edge *read_edges(FILE *stream, const char *name, size_t *num_vertices,
+                 size_t *num_edges) {
+  Edge *edges = NULL;
+  size_t capacity = 0;
+  bool header = false;
+  size_t index = 0;
+  size_t number = 0;
+  char *line = NULL;
+  size_t size = 0;
+  bool valid = true;
+  *num_vertices = 0;
+  *num_edges = 0;
+  while (valid && getline(&line, &size, stream) != -1) {
+    number++;
+    char *cursor = line + 1;
+    size_t u, v;
+    if (line[0] == 'p') {
+      char format[16];
+      int skipped = 0;
+      bool parsed =
+          !header && sscanf(cursor, " %15s%n", format, &skipped) == 1;
+      cursor += skipped;
+      if (!parsed || !read_number(&cursor, num_vertices) ||
+          !read_number(&cursor, num_edges) || !*num_vertices) {
+        fprintf(stderr, "%s:%zu: invalid problem line\n", name, number);
+        valid = false;
+      } else {
+        header = true;
+      }
+    } else if (line[0] == 'e') {
+      if (!header || !read_number(&cursor, &u) || !read_number(&cursor, &v) ||
+          !u || u > *num_vertices || !v || v > *num_vertices) {
+        fprintf(stderr, "%s:%zu: invalid edge line\n", name, number);
+        valid = false;
+      } else if (index == *num_edges) {
+        fprintf(stderr, "%s:%zu: more than %zu edges\n", name, number,
+                *num_edges);
+        valid = false;
+      } else if (u == v) {
+        fprintf(stderr, "%s:%zu: self-loop on vertex %zu\n", name, number, u);
+        valid = false;
+      } else {
+        if (index == capacity) {
+          // Double the capacity of the edges
+          size_t grown = capacity ? 2 * capacity : 1024;
+          Edge *resized = grown <= SIZE_MAX / sizeof(Edge)
+                              ? realloc(edges, grown * sizeof(Edge))
+                              : NULL;
+          if (resized == NULL) {
+            fprintf(stderr, "%s: not enough memory\n", name);
+            valid = false;
+          } else {
+            edges = resized;
+            capacity = grown;
+          }
+        }
+        if (valid) {
+          edges[index].u = (u < v ? u : v) - 1;
+          edges[index].v = (u < v ? v : u) - 1;
+          index++;
+        }
+      }
+    }
+    // Other lines (comments) are ignored
+  }
+  free(line);
+  if (valid && !header) {
+    fprintf(stderr, "%s: missing problem line\n", name);
+    valid = false;
+  } else if (valid && index != *num_edges) {
+    fprintf(stderr, "%s: %zu edges read, %zu expected\n", name, index,
+            *num_edges);
+    valid = false;
+  } else if (valid && edges == NULL) {
+    // A graph without edges still gets an array, NULL reporting an error
+    edges = malloc(sizeof(Edge));
+    if (edges == NULL) {
+      fprintf(stderr, "%s: not enough memory\n", name);
+      valid = false;
+    }
+  }
+  if (!valid) {
+    free(edges);
+    edges = NULL;
+    *num_vertices = 0;
+  }
+  return edges;
+}
+
+// Load a DIMACS graph: the edges listed twice (in both directions for
+// example) are skipped and the constraints of the distinct edges are
+// allocated at once. A graph without edges has no problem and only sets the
+// number of vertices.
+CSPProblem *load_graph(FILE *stream, const char *name,
+                       CSPConstraint **constraints, size_t *num_vertices,
+                       size_t *num_edges, size_t *max_degree) {
+  *constraints = NULL;
+  *num_edges = 0;
+  *max_degree = 0;
+  size_t count;
+  Edge *edges = read_edges(stream, name, num_vertices, &count);
+  if (edges == NULL) {
+    return NULL;
+  }
+  // Keep the distinct edges
+  qsort(edges, count, sizeof(Edge), compare_edges);
+  for (size_t i = 0; i < count; i++) {
+    if (!*num_edges || compare_edges(&edges[*num_edges - 1], &edges[i])) {
+      edges[(*num_edges)++] = edges[i];
+    }
+  }
+  CSPProblem *problem = NULL;
+  size_t *degrees = NULL;
+  if (*num_edges) {
+    problem = csp_problem_create(*num_vertices, *num_edges);
+    *constraints = csp_constraints_create(*num_edges, 2, different_colours);
+    degrees = calloc(*num_vertices, sizeof(size_t));
+    if (problem == NULL || *constraints == NULL || degrees == NULL) {
+      fprintf(stderr, "%s: not enough memory\n", name);
+      if (*constraints != NULL) {
+        csp_constraints_destroy(*constraints, *num_edges);
+        *constraints = NULL;
+      }
+      if (problem != NULL) {
+        csp_problem_destroy(problem);
+        problem = NULL;
+      }
+      *num_vertices = 0;
+    }
+  }
+  for (size_t i = 0; problem != NULL && i < *num_edges; i++) {
+    CSPConstraint *constraint = csp_constraints_get(*constraints, i);
+    csp_constraint_set_variable(constraint, 0, edges[i].u);
+    csp_constraint_set_variable(constraint, 1, edges[i].v);
+    csp_problem_set_constraint(problem, i, constraint);
+    if (++degrees[edges[i].u] > *max_degree) {
+      *max_degree = degrees[edges[i].u];
+    }
+    if (++degrees[edges[i].v] > *max_degree) {
+      *max_degree = degrees[edges[i].v];
+    }
+  }
+  free(degrees);
+  free(edges);
+  return problem;
+}
+
+// Print the usage
+int usage(const char *program) {
+  fprintf(stderr, "Usage: %s <file.col> [<colours>]\n", program);
+  return EXIT_FAILURE;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 2 && argc != 3) {
+    return usage(argv[0]);
+  }
+  const char *path = argv[1];
+  size_t colours = 0;
+  if (argc == 3 && (sscanf(argv[2], "%zu", &colours) != 1 || !colours)) {
+    fprintf(stderr, "Invalid number of colours: %s\n", argv[2]);
+    return EXIT_FAILURE;
+  }
+  FILE *stream = fopen(path, "r");
+  if (stream == NULL) {
+    fprintf(stderr, "Cannot open %s\n", path);
+    return EXIT_FAILURE;
+  }
+
+  // Initialise the library
+  csp_init();
+  int status = EXIT_FAILURE;
+  {
+    // Load the graph
+    CSPConstraint *constraints;
+    size_t num_vertices, num_edges, max_degree;
+    CSPProblem *problem = load_graph(stream, path, &constraints, &num_vertices,
+                                     &num_edges, &max_degree);
+    fclose(stream);
+    // Max degree + 1 colours are always enough
+    if (!colours) {
+      colours = max_degree + 1;
+    }
+    // The errors have been reported by the loader
+    if (problem == NULL && num_vertices) {
+      // Without edges a single colour is enough and nothing is searched
+      printf("vertices: %zu\nedges: 0\ncolours: %zu\nused colours: 1\n"
+             "time: %.6f s\nnodes: 0\n",
+             num_vertices, colours, 0.0);
+      status = EXIT_SUCCESS;
+    } else if (problem != NULL) {
+      for (size_t i = 0; i < num_vertices; i++) {
+        csp_problem_set_domain(problem, i, colours);
+      }
+      size_t *values = calloc(num_vertices, sizeof(size_t));
+
+      // Solve the CSP problem, only counting the nodes so that the checks are
+      // not slowed down
+      bool counted = csp_problem_count_nodes(problem);
+      struct timespec start, end;
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      bool result = values != NULL && csp_problem_solve(problem, values, NULL);
+      clock_gettime(CLOCK_MONOTONIC, &end);
+
+      // Report the colours, the time and the nodes
+      printf("vertices: %zu\nedges: %zu\ncolours: %zu\n", num_vertices,
+             num_edges, colours);
+      if (result) {
+        size_t used = 0;
+        for (size_t i = 0; i < num_vertices; i++) {
+          if (values[i] + 1 > used) {
+            used = values[i] + 1;
+          }
+        }
+        printf("used colours: %zu\n", used);
+        status = EXIT_SUCCESS;
+      } else {
+        printf("No colouring found\n");
+      }
+      printf("time: %.6f s\n", (double)(end.tv_sec - start.tv_sec) +
+                                   (double)(end.tv_nsec - start.tv_nsec) / 1e9);
+      if (counted) {
+        size_t nodes = 0;
+        for (size_t i = 0; i < num_vertices; i++) {
+          nodes += csp_problem_get_profile_nodes(problem, i);
+        }
+        printf("nodes: %zu\n", nodes);
+      }
+
+      // Destroy the CSP problem
+      free(values);
+      csp_problem_destroy(problem);
+      csp_constraints_destroy(constraints, num_edges);
+    }
+  }
+  // Finish the library
+  csp_finish();
+
+  return status;
+}
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "csp.h"
 
@@ -57,18 +58,53 @@ void print_solution(unsigned int number, size_t *queens) {
   printf("───┘\n");
 }
 
+// Print the usage
+int usage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s <number>\n"
+          "       %s <number> split <file> <cubes>\n"
+          "       %s <number> work <file>\n"
+          "       %s <number> cubes <file> <cubes> <workers>\n",
+          program, program, program, program);
+  return EXIT_FAILURE;
+}
+
 int main(int argc, char *argv[]) {
-  if (argc != 2) {
-    fprintf(stderr, "Usage: %s <number>\n", argv[0]);
-    return EXIT_FAILURE;
+  if (argc < 2) {
+    return usage(argv[0]);
   }
   unsigned int number;
   if (sscanf(argv[1], "%u", &number) != 1) {
     fprintf(stderr, "Invalid number: %s\n", argv[1]);
     return EXIT_FAILURE;
   }
+  // Parse the cube-and-conquer mode
+  const char *mode = argc > 2 ? argv[2] : NULL;
+  size_t cubes = 0;
+  size_t workers = 0;
+  if (mode == NULL) {
+    if (argc != 2) {
+      return usage(argv[0]);
+    }
+  } else if (!strcmp(mode, "split")) {
+    if (argc != 5 || sscanf(argv[4], "%zu", &cubes) != 1) {
+      return usage(argv[0]);
+    }
+  } else if (!strcmp(mode, "work")) {
+    if (argc != 4) {
+      return usage(argv[0]);
+    }
+  } else if (!strcmp(mode, "cubes")) {
+    if (argc != 6 || sscanf(argv[4], "%zu", &cubes) != 1 ||
+        sscanf(argv[5], "%zu", &workers) != 1 || !workers) {
+      return usage(argv[0]);
+    }
+  } else {
+    return usage(argv[0]);
+  }
 
   // Initialise the library
+  CSPCubeResult outcome = CSP_CUBE_UNSATISFIABLE;
   csp_init();
   {
     // Create the queens array
@@ -98,7 +134,27 @@ int main(int argc, char *argv[]) {
     }
 
     // Solve the CSP problem
-    bool result = csp_problem_solve(problem, queens, NULL);
+    bool result;
+    if (mode == NULL) {
+      result = csp_problem_solve(problem, queens, NULL);
+    } else if (!strcmp(mode, "split")) {
+      // Only write the work file
+      size_t count = 0;
+      result = false;
+      if (csp_cube_split(problem, NULL, cubes, argv[3], &count)) {
+        printf("%zu cubes written to %s\n", count, argv[3]);
+      } else {
+        fprintf(stderr, "Cannot write %s\n", argv[3]);
+      }
+    } else {
+      if (!strcmp(mode, "work")) {
+        outcome = csp_cube_work(problem, queens, NULL, argv[3]);
+      } else {
+        outcome =
+            csp_cube_solve(problem, queens, NULL, argv[3], cubes, workers);
+      }
+      result = outcome == CSP_CUBE_SOLVED;
+    }
 
     // Destroy the CSP problem
     while (index--) {
@@ -109,7 +165,9 @@ int main(int argc, char *argv[]) {
     // Print the solution
     if (result) {
       print_solution(number, queens);
-    } else {
+    } else if (outcome == CSP_CUBE_INCOMPLETE) {
+      printf("Some cubes of %s have not been completed\n", argv[3]);
+    } else if (mode == NULL || strcmp(mode, "split")) {
       printf("No solution found\n");
     }
 
@@ -119,5 +177,5 @@ int main(int argc, char *argv[]) {
   // Finish the library
   csp_finish();
 
-  return EXIT_SUCCESS;
+  return outcome == CSP_CUBE_INCOMPLETE ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -17,10 +17,18 @@
 #include "csp.h"
 
 #include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "csp.inc"
 
@@ -53,6 +61,358 @@ bool csp_finish(void) {
 
 bool csp_initialised(void) { return counter > 0; }
 
+// The value returned when a domain has no more values
+#define CSP_NONE SIZE_MAX
+
+// Release the values of a domain
+static void _csp_domain_free(CSPDomain *domain) {
+  if (domain->kind == CSP_LIST) {
+    free(domain->values);
+  } else if (domain->kind == CSP_BITSET) {
+    free(domain->bits);
+  }
+  domain->kind = CSP_INTERVAL;
+  domain->values = NULL;
+}
+
+// Set a domain to the interval of count values starting at min
+static void _csp_domain_set_interval(CSPDomain *domain, size_t min,
+                                     size_t count) {
+  _csp_domain_free(domain);
+  domain->kind = CSP_INTERVAL;
+  domain->size = count;
+  domain->min = min;
+  domain->max = count ? min + count - 1 : min;
+}
+
+// Set a domain to sorted distinct values, choosing its representation by
+// density: an interval if the values are contiguous, a bitset if it is not
+// larger than the list, and the list otherwise
+static bool _csp_domain_set_values(CSPDomain *domain, const size_t *values,
+                                   size_t count) {
+  if (!count || values[count - 1] - values[0] == count - 1) {
+    _csp_domain_set_interval(domain, count ? values[0] : 0, count);
+    return true;
+  }
+  size_t span = values[count - 1] - values[0];
+  size_t *list = NULL;
+  uint64_t *bits = NULL;
+  if (span / 64 < count) {
+    bits = calloc(span / 64 + 1, sizeof(uint64_t));
+    if (bits == NULL) {
+      return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+      size_t offset = values[i] - values[0];
+      bits[offset / 64] |= (uint64_t)1 << (offset % 64);
+    }
+  } else {
+    list = malloc(count * sizeof(size_t));
+    if (list == NULL) {
+      return false;
+    }
+    memcpy(list, values, count * sizeof(size_t));
+  }
+  _csp_domain_free(domain);
+  domain->kind = bits != NULL ? CSP_BITSET : CSP_LIST;
+  domain->size = count;
+  domain->min = values[0];
+  domain->max = values[count - 1];
+  if (bits != NULL) {
+    domain->bits = bits;
+  } else {
+    domain->values = list;
+  }
+  return true;
+}
+
+// Find the position of the first value of a list not less than the value
+static size_t _csp_domain_search(const CSPDomain *domain, size_t value) {
+  size_t low = 0;
+  size_t high = domain->size;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (domain->values[middle] < value) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+// Get the smallest value of a domain not less than the value (CSP_NONE if
+// there is none)
+static size_t _csp_domain_next(const CSPDomain *domain, size_t value) {
+  if (!domain->size || value > domain->max) {
+    return CSP_NONE;
+  }
+  if (value <= domain->min) {
+    return domain->min;
+  }
+  switch (domain->kind) {
+    case CSP_LIST:
+      return domain->values[_csp_domain_search(domain, value)];
+    case CSP_BITSET: {
+      size_t offset = value - domain->min;
+      size_t word = offset / 64;
+      uint64_t bits = domain->bits[word] & (~(uint64_t)0 << (offset % 64));
+      // The largest value stops the scan
+      while (!bits) {
+        bits = domain->bits[++word];
+      }
+      return domain->min + word * 64 + (size_t)__builtin_ctzll(bits);
+    }
+    default:
+      return value;
+  }
+}
+
+// Verify if a domain contains the value
+static bool _csp_domain_contains(const CSPDomain *domain, size_t value) {
+  if (!domain->size || value < domain->min || value > domain->max) {
+    return false;
+  }
+  switch (domain->kind) {
+    case CSP_LIST:
+      return domain->values[_csp_domain_search(domain, value)] == value;
+    case CSP_BITSET: {
+      size_t offset = value - domain->min;
+      return (domain->bits[offset / 64] >> (offset % 64)) & 1;
+    }
+    default:
+      return true;
+  }
+}
+
+// Copy the values of a domain in ascending order
+static void _csp_domain_copy(const CSPDomain *domain, size_t *values) {
+  size_t count = 0;
+  for (size_t value = _csp_domain_next(domain, 0); value != CSP_NONE;
+       value = _csp_domain_next(domain, value + 1)) {
+    values[count++] = value;
+  }
+}
+
+// Release the entries of a cache, they are reallocated on the next lookup
+static void _csp_cache_invalidate(CSPCache *cache) {
+  free(cache->radix);
+  free(cache->offset);
+  free(cache->keys);
+  free(cache->results);
+  cache->radix = NULL;
+  cache->offset = NULL;
+  cache->keys = NULL;
+  cache->results = NULL;
+  cache->size = 0;
+}
+
+// Allocate the entries of a cache for the domains of the problem
+static bool _csp_cache_prepare(CSPCache *cache, const CSPProblem *csp,
+                               const CSPConstraint *constraint) {
+  // Compute the number of value tuples spanned by the domains
+  size_t product = 1;
+  bool direct = true;
+  for (size_t i = 0; i < constraint->arity && direct; i++) {
+    const CSPDomain *domain = &csp->domains[constraint->variables[i]];
+    size_t span = domain->max - domain->min + 1;
+    if (!domain->size || !span || product > cache->capacity / span) {
+      direct = false;
+    } else {
+      product *= span;
+    }
+  }
+  if (direct) {
+    // One entry per value tuple
+    cache->radix = malloc(constraint->arity * sizeof(size_t));
+    cache->offset = malloc(constraint->arity * sizeof(size_t));
+    cache->results = calloc(product, sizeof(unsigned char));
+    if (cache->radix == NULL || cache->offset == NULL ||
+        cache->results == NULL) {
+      _csp_cache_invalidate(cache);
+      return false;
+    }
+    for (size_t i = 0; i < constraint->arity; i++) {
+      const CSPDomain *domain = &csp->domains[constraint->variables[i]];
+      cache->radix[i] = domain->max - domain->min + 1;
+      cache->offset[i] = domain->min;
+    }
+    cache->size = product;
+  } else {
+    // The largest power of two not greater than the capacity
+    size_t size = 1;
+    while (size <= cache->capacity / 2) {
+      size *= 2;
+    }
+    cache->keys = malloc(size * constraint->arity * sizeof(size_t));
+    cache->results = calloc(size, sizeof(unsigned char));
+    if (cache->keys == NULL || cache->results == NULL) {
+      _csp_cache_invalidate(cache);
+      return false;
+    }
+    cache->size = size;
+  }
+  cache->direct = direct;
+  return true;
+}
+
+// Check a constraint, consulting its cache if it is enabled
+static bool _csp_cache_check(const CSPProblem *csp, CSPConstraint *constraint,
+                             const size_t *values, const void *data) {
+  CSPCache *cache = constraint->cache;
+  if (cache == NULL) {
+    return constraint->check(constraint, values, data);
+  }
+  // The cached results are only valid for the same data
+  if (cache->size && cache->data != data) {
+    _csp_cache_invalidate(cache);
+  }
+  if (!cache->size) {
+    if (!_csp_cache_prepare(cache, csp, constraint)) {
+      cache->misses++;
+      return constraint->check(constraint, values, data);
+    }
+    cache->data = data;
+  }
+  // Find the entry of the value tuple
+  size_t slot = 0;
+  if (cache->direct) {
+    for (size_t i = 0; i < constraint->arity; i++) {
+      size_t value = values[constraint->variables[i]] - cache->offset[i];
+      if (values[constraint->variables[i]] < cache->offset[i] ||
+          value >= cache->radix[i]) {
+        // Out of the domains the cache has been prepared for
+        cache->misses++;
+        return constraint->check(constraint, values, data);
+      }
+      slot = slot * cache->radix[i] + value;
+    }
+    if (cache->results[slot]) {
+      cache->hits++;
+      return cache->results[slot] == 2;
+    }
+  } else {
+    size_t hash = 0;
+    for (size_t i = 0; i < constraint->arity; i++) {
+      hash = (hash ^ values[constraint->variables[i]]) *
+             (size_t)0x9E3779B97F4A7C15ULL;
+    }
+    slot = (hash ^ (hash >> 29)) & (cache->size - 1);
+    size_t *key = cache->keys + slot * constraint->arity;
+    if (cache->results[slot]) {
+      size_t i = 0;
+      while (i < constraint->arity &&
+             key[i] == values[constraint->variables[i]]) {
+        i++;
+      }
+      if (i == constraint->arity) {
+        cache->hits++;
+        return cache->results[slot] == 2;
+      }
+    }
+    // Replace the entry
+    for (size_t i = 0; i < constraint->arity; i++) {
+      key[i] = values[constraint->variables[i]];
+    }
+  }
+  cache->misses++;
+  bool result = constraint->check(constraint, values, data);
+  cache->results[slot] = result ? 2 : 1;
+  return result;
+}
+
+// Check the constraint at the specified index, recording its statistics if
+// the problem is profiled
+static bool _csp_constraint_check(const CSPProblem *csp, size_t index,
+                                  const size_t *values, const void *data) {
+  CSPConstraint *constraint = csp->constraints[index];
+  CSPProfile *profile = csp->profile;
+  if (profile == NULL || profile->statistics == NULL) {
+    return _csp_cache_check(csp, constraint, values, data);
+  }
+  CSPStatistics *statistics = &profile->statistics[index];
+  bool result;
+  statistics->checks++;
+  if (statistics->countdown) {
+    statistics->countdown--;
+    result = _csp_cache_check(csp, constraint, values, data);
+  } else {
+    statistics->countdown = profile->sampling - 1;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    result = _csp_cache_check(csp, constraint, values, data);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    statistics->samples++;
+    statistics->nanoseconds +=
+        (size_t)((end.tv_sec - start.tv_sec) * 1000000000L +
+                 (end.tv_nsec - start.tv_nsec));
+  }
+  if (!result) {
+    statistics->failures++;
+  }
+  return result;
+}
+
+// Count a node of a single-threaded search at the specified depth if the
+// problem is profiled
+static void _csp_profile_node(const CSPProblem *csp, size_t depth) {
+  if (csp->profile != NULL) {
+    csp->profile->nodes[depth]++;
+  }
+}
+
+// Get the position in the order of the last variable of a constraint (the
+// order is the natural one if position is NULL)
+static size_t _csp_last_position(const CSPConstraint *constraint,
+                                 const size_t *position) {
+  size_t last = 0;
+  for (size_t i = 0; i < constraint->arity; i++) {
+    size_t variable = constraint->variables[i];
+    if (position != NULL) {
+      variable = position[variable];
+    }
+    if (variable > last) {
+      last = variable;
+    }
+  }
+  return last;
+}
+
+// Group the constraints by the position of their last variable
+static void _csp_group_constraints(const CSPProblem *csp,
+                                   const size_t *position, size_t *buckets,
+                                   size_t *constraints) {
+  size_t n = csp->num_domains;
+  memset(buckets, 0, (n + 1) * sizeof(size_t));
+  for (size_t i = 0; i < csp->num_constraints; i++) {
+    assert(csp->constraints[i] != NULL);
+    buckets[_csp_last_position(csp->constraints[i], position) + 1]++;
+  }
+  for (size_t i = 0; i < n; i++) {
+    buckets[i + 1] += buckets[i];
+  }
+  for (size_t i = 0; i < csp->num_constraints; i++) {
+    size_t last = _csp_last_position(csp->constraints[i], position);
+    constraints[buckets[last]++] = i;
+  }
+  // The placement has shifted the offsets by one bucket
+  memmove(buckets + 1, buckets, n * sizeof(size_t));
+  buckets[0] = 0;
+}
+
+// Check the constraints completed by the variable at the specified position
+// of the order, as grouped by _csp_group_constraints
+static bool _csp_bucket_check(const CSPProblem *csp, const size_t *buckets,
+                              const size_t *constraints, size_t position,
+                              const size_t *values, const void *data) {
+  for (size_t j = buckets[position]; j < buckets[position + 1]; j++) {
+    if (!_csp_constraint_check(csp, constraints[j], values, data)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 CSPConstraint *csp_constraint_create(size_t arity, CSPChecker *check) {
   assert(csp_initialised());
   assert(arity > 0);
@@ -64,14 +424,60 @@ CSPConstraint *csp_constraint_create(size_t arity, CSPChecker *check) {
   if (constraint != NULL) {
     constraint->arity = arity;
     constraint->check = check;
+    constraint->cache = NULL;
     memset(constraint->variables, 0, arity * sizeof(size_t));
   }
   return constraint;
 }
 
+// Get the size of a constraint of the specified arity
+static size_t _csp_constraint_size(size_t arity) {
+  return sizeof(CSPConstraint) + arity * sizeof(size_t);
+}
+
+CSPConstraint *csp_constraints_create(size_t count, size_t arity,
+                                      CSPChecker *check) {
+  assert(csp_initialised());
+  assert(count > 0);
+  assert(arity > 0);
+  assert(check != NULL);
+  assert(printf("Creating %lu constraints with arity %lu\n", count, arity));
+  // Allocate memory for all the constraints at once
+  size_t size = _csp_constraint_size(arity);
+  if (count > SIZE_MAX / size) {
+    return NULL;
+  }
+  char *constraints = calloc(count, size);
+  if (constraints != NULL) {
+    for (size_t i = 0; i < count; i++) {
+      CSPConstraint *constraint = (CSPConstraint *)(constraints + i * size);
+      constraint->arity = arity;
+      constraint->check = check;
+    }
+  }
+  return (CSPConstraint *)constraints;
+}
+
+CSPConstraint *csp_constraints_get(CSPConstraint *constraints, size_t index) {
+  assert(csp_initialised());
+  return (CSPConstraint *)((char *)constraints +
+                           index * _csp_constraint_size(constraints->arity));
+}
+
+void csp_constraints_destroy(CSPConstraint *constraints, size_t count) {
+  assert(csp_initialised());
+  assert(printf("Destroying %lu constraints with arity %lu\n", count,
+                constraints->arity));
+  for (size_t i = 0; i < count; i++) {
+    csp_constraint_set_cache(csp_constraints_get(constraints, i), 0);
+  }
+  free(constraints);
+}
+
 void csp_constraint_destroy(CSPConstraint *constraint) {
   assert(csp_initialised());
   assert(printf("Destroying constraint with arity %lu\n", constraint->arity));
+  csp_constraint_set_cache(constraint, 0);
   free(constraint);
 }
 
@@ -90,6 +496,10 @@ void csp_constraint_set_variable(CSPConstraint *constraint, size_t index,
   assert(csp_initialised());
   assert(index < constraint->arity);
   constraint->variables[index] = variable;
+  // The cached results are no longer valid
+  if (constraint->cache != NULL) {
+    _csp_cache_invalidate(constraint->cache);
+  }
 }
 
 size_t csp_constraint_get_variable(const CSPConstraint *constraint,
@@ -109,6 +519,54 @@ bool csp_constraint_to_check(const CSPConstraint *constraint, size_t index) {
   return true;
 }
 
+bool csp_constraint_set_cache(CSPConstraint *constraint, size_t capacity) {
+  assert(csp_initialised());
+  assert(constraint != NULL);
+  if (constraint->cache != NULL) {
+    _csp_cache_invalidate(constraint->cache);
+    if (!capacity) {
+      free(constraint->cache);
+      constraint->cache = NULL;
+      return true;
+    }
+  } else if (capacity) {
+    constraint->cache = calloc(1, sizeof(CSPCache));
+    if (constraint->cache == NULL) {
+      return false;
+    }
+  } else {
+    return true;
+  }
+  constraint->cache->capacity = capacity;
+  constraint->cache->hits = 0;
+  constraint->cache->misses = 0;
+  return true;
+}
+
+size_t csp_constraint_get_cache(const CSPConstraint *constraint) {
+  assert(csp_initialised());
+  return constraint->cache != NULL ? constraint->cache->capacity : 0;
+}
+
+void csp_constraint_clear_cache(CSPConstraint *constraint) {
+  assert(csp_initialised());
+  if (constraint->cache != NULL) {
+    _csp_cache_invalidate(constraint->cache);
+    constraint->cache->hits = 0;
+    constraint->cache->misses = 0;
+  }
+}
+
+size_t csp_constraint_get_cache_hits(const CSPConstraint *constraint) {
+  assert(csp_initialised());
+  return constraint->cache != NULL ? constraint->cache->hits : 0;
+}
+
+size_t csp_constraint_get_cache_misses(const CSPConstraint *constraint) {
+  assert(csp_initialised());
+  return constraint->cache != NULL ? constraint->cache->misses : 0;
+}
+
 CSPProblem *csp_problem_create(size_t num_domains, size_t num_constraints) {
   assert(csp_initialised());
   assert(num_domains > 0);
@@ -119,7 +577,7 @@ CSPProblem *csp_problem_create(size_t num_domains, size_t num_constraints) {
   CSPProblem *csp = malloc(sizeof(CSPProblem));
   if (csp != NULL) {
     // Allocate memory for the domains of the CSP problem
-    csp->domains = calloc(num_domains, sizeof(size_t));
+    csp->domains = calloc(num_domains, sizeof(CSPDomain));
     if (csp->domains != NULL) {
       // Allocate memory for the contraints of the CSP problem
       csp->constraints = malloc(num_constraints * sizeof(CSPConstraint *));
@@ -129,6 +587,8 @@ CSPProblem *csp_problem_create(size_t num_domains, size_t num_constraints) {
         }
         csp->num_domains = num_domains;
         csp->num_constraints = num_constraints;
+        csp->num_threads = 1;
+        csp->profile = NULL;
       } else {
         free(csp->domains);
         free(csp);
@@ -149,6 +609,10 @@ void csp_problem_destroy(CSPProblem *csp) {
   assert(csp_initialised());
   assert(printf("Destroying CSP problem with %lu domains and %lu constraints\n",
                 csp->num_domains, csp->num_constraints));
+  csp_problem_set_profiling(csp, 0);
+  for (size_t i = 0; i < csp->num_domains; i++) {
+    _csp_domain_free(&csp->domains[i]);
+  }
   free(csp->constraints);
   free(csp->domains);
   free(csp);
@@ -186,13 +650,310 @@ size_t csp_problem_get_num_domains(const CSPProblem *csp) {
 void csp_problem_set_domain(CSPProblem *csp, size_t index, size_t domain) {
   assert(csp_initialised());
   assert(index < csp->num_domains);
-  csp->domains[index] = domain;
+  _csp_domain_set_interval(&csp->domains[index], 0, domain);
+}
+
+void csp_problem_set_domain_interval(CSPProblem *csp, size_t index,
+                                     size_t min, size_t max) {
+  assert(csp_initialised());
+  assert(index < csp->num_domains);
+  assert(min <= max && max < CSP_NONE);
+  _csp_domain_set_interval(&csp->domains[index], min, max - min + 1);
+}
+
+// Compare two values for qsort
+static int _csp_compare_values(const void *a, const void *b) {
+  size_t va = *(const size_t *)a;
+  size_t vb = *(const size_t *)b;
+  return va < vb ? -1 : va > vb;
+}
+
+bool csp_problem_set_domain_values(CSPProblem *csp, size_t index,
+                                   const size_t *values, size_t count) {
+  assert(csp_initialised());
+  assert(index < csp->num_domains);
+  assert(values != NULL || !count);
+  size_t *sorted = malloc((count ? count : 1) * sizeof(size_t));
+  if (sorted == NULL) {
+    return false;
+  }
+  // Sort the values and remove the duplicates
+  if (count) {
+    memcpy(sorted, values, count * sizeof(size_t));
+    qsort(sorted, count, sizeof(size_t), _csp_compare_values);
+  }
+  size_t unique = 0;
+  for (size_t i = 0; i < count; i++) {
+    assert(sorted[i] < CSP_NONE);
+    if (!unique || sorted[unique - 1] != sorted[i]) {
+      sorted[unique++] = sorted[i];
+    }
+  }
+  bool result = _csp_domain_set_values(&csp->domains[index], sorted, unique);
+  free(sorted);
+  return result;
+}
+
+size_t csp_problem_get_domain_values(const CSPProblem *csp, size_t index,
+                                     size_t *values) {
+  assert(csp_initialised());
+  assert(index < csp->num_domains);
+  _csp_domain_copy(&csp->domains[index], values);
+  return csp->domains[index].size;
+}
+
+size_t csp_problem_get_domain_memory(const CSPProblem *csp, size_t index) {
+  assert(csp_initialised());
+  assert(index < csp->num_domains);
+  const CSPDomain *domain = &csp->domains[index];
+  if (domain->kind == CSP_LIST) {
+    return domain->size * sizeof(size_t);
+  } else if (domain->kind == CSP_BITSET) {
+    return ((domain->max - domain->min) / 64 + 1) * sizeof(uint64_t);
+  }
+  return 0;
+}
+
+bool csp_problem_in_domain(const CSPProblem *csp, size_t index, size_t value) {
+  assert(csp_initialised());
+  assert(index < csp->num_domains);
+  return _csp_domain_contains(&csp->domains[index], value);
+}
+
+bool csp_problem_prune(CSPProblem *csp, const void *data) {
+  assert(csp_initialised());
+  size_t *values = calloc(csp->num_domains, sizeof(size_t));
+  size_t *buckets = malloc((csp->num_domains + 1) * sizeof(size_t));
+  size_t *constraints = malloc(csp->num_constraints * sizeof(size_t));
+  size_t *kept = NULL;
+  bool result = values != NULL && buckets != NULL && constraints != NULL;
+  if (result) {
+    _csp_group_constraints(csp, NULL, buckets, constraints);
+  }
+  for (size_t index = 0; index < csp->num_domains && result; index++) {
+    CSPDomain *domain = &csp->domains[index];
+    // Only the constraints on this single variable can prune its domain
+    size_t unary = 0;
+    for (size_t j = buckets[index]; j < buckets[index + 1]; j++) {
+      const CSPConstraint *constraint = csp->constraints[constraints[j]];
+      size_t k = 0;
+      while (k < constraint->arity && constraint->variables[k] == index) {
+        k++;
+      }
+      if (k == constraint->arity) {
+        constraints[buckets[index] + unary++] = constraints[j];
+      }
+    }
+    if (!unary || !domain->size) {
+      continue;
+    }
+    size_t *resized = realloc(kept, domain->size * sizeof(size_t));
+    if (resized == NULL) {
+      result = false;
+      break;
+    }
+    kept = resized;
+    // Keep the values satisfying these constraints
+    size_t count = 0;
+    for (size_t value = _csp_domain_next(domain, 0); value != CSP_NONE;
+         value = _csp_domain_next(domain, value + 1)) {
+      values[index] = value;
+      size_t j = 0;
+      while (j < unary &&
+             _csp_constraint_check(csp, constraints[buckets[index] + j],
+                                   values, data)) {
+        j++;
+      }
+      if (j == unary) {
+        kept[count++] = value;
+      }
+    }
+    if (count < domain->size) {
+      result = _csp_domain_set_values(domain, kept, count);
+    }
+  }
+  free(values);
+  free(buckets);
+  free(constraints);
+  free(kept);
+  return result;
 }
 
 size_t csp_problem_get_domain(const CSPProblem *csp, size_t index) {
   assert(csp_initialised());
   assert(index < csp->num_domains);
-  return csp->domains[index];
+  return csp->domains[index].size;
+}
+
+void csp_problem_set_num_threads(CSPProblem *csp, size_t num_threads) {
+  assert(csp_initialised());
+  csp->num_threads = num_threads;
+}
+
+size_t csp_problem_get_num_threads(const CSPProblem *csp) {
+  assert(csp_initialised());
+  return csp->num_threads;
+}
+
+// Release the profile of a problem
+static void _csp_profile_free(CSPProblem *csp) {
+  if (csp->profile != NULL) {
+    free(csp->profile->statistics);
+    free(csp->profile->nodes);
+    free(csp->profile);
+    csp->profile = NULL;
+  }
+}
+
+// Replace the profile of a problem by a cleared one, timing one check out of
+// sampling or only counting the nodes if sampling is 0
+static bool _csp_profile_reset(CSPProblem *csp, size_t sampling) {
+  _csp_profile_free(csp);
+  CSPProfile *profile = malloc(sizeof(CSPProfile));
+  if (profile == NULL) {
+    return false;
+  }
+  profile->sampling = sampling;
+  profile->statistics =
+      sampling ? calloc(csp->num_constraints, sizeof(CSPStatistics)) : NULL;
+  profile->nodes = calloc(csp->num_domains, sizeof(size_t));
+  if ((sampling && profile->statistics == NULL) || profile->nodes == NULL) {
+    free(profile->statistics);
+    free(profile->nodes);
+    free(profile);
+    return false;
+  }
+  // Stagger the timed checks, so that one constraint out of sampling times its
+  // first check rather than all of them
+  for (size_t i = 0; sampling && i < csp->num_constraints; i++) {
+    profile->statistics[i].countdown = i % sampling;
+  }
+  csp->profile = profile;
+  return true;
+}
+
+bool csp_problem_set_profiling(CSPProblem *csp, size_t sampling) {
+  assert(csp_initialised());
+  if (!sampling) {
+    _csp_profile_free(csp);
+    return true;
+  }
+  return _csp_profile_reset(csp, sampling);
+}
+
+bool csp_problem_count_nodes(CSPProblem *csp) {
+  assert(csp_initialised());
+  return _csp_profile_reset(csp, 0);
+}
+
+size_t csp_problem_get_profiling(const CSPProblem *csp) {
+  assert(csp_initialised());
+  return csp->profile != NULL ? csp->profile->sampling : 0;
+}
+
+size_t csp_problem_get_profile_checks(const CSPProblem *csp, size_t index) {
+  assert(csp_initialised());
+  assert(csp->profile != NULL && csp->profile->statistics != NULL);
+  assert(index < csp->num_constraints);
+  return csp->profile->statistics[index].checks;
+}
+
+size_t csp_problem_get_profile_failures(const CSPProblem *csp, size_t index) {
+  assert(csp_initialised());
+  assert(csp->profile != NULL && csp->profile->statistics != NULL);
+  assert(index < csp->num_constraints);
+  return csp->profile->statistics[index].failures;
+}
+
+double csp_problem_get_profile_time(const CSPProblem *csp, size_t index) {
+  assert(csp_initialised());
+  assert(csp->profile != NULL && csp->profile->statistics != NULL);
+  assert(index < csp->num_constraints);
+  const CSPStatistics *statistics = &csp->profile->statistics[index];
+  if (!statistics->samples) {
+    return 0;
+  }
+  return (double)statistics->nanoseconds / 1e9 *
+         ((double)statistics->checks / (double)statistics->samples);
+}
+
+size_t csp_problem_get_profile_nodes(const CSPProblem *csp, size_t depth) {
+  assert(csp_initialised());
+  assert(csp->profile != NULL);
+  assert(depth < csp->num_domains);
+  return csp->profile->nodes[depth];
+}
+
+/**
+ * @brief A line of the profile report.
+ * @var index The index of the constraint.
+ * @var time The estimated time of the constraint.
+ * @var checks The number of checks of the constraint.
+ */
+typedef struct {
+  size_t index;
+  double time;
+  size_t checks;
+} CSPProfileLine;
+
+// Compare two lines by decreasing estimated time, then by decreasing checks
+static int _csp_compare_lines(const void *a, const void *b) {
+  const CSPProfileLine *la = a;
+  const CSPProfileLine *lb = b;
+  if (la->time != lb->time) {
+    return la->time < lb->time ? 1 : -1;
+  }
+  if (la->checks != lb->checks) {
+    return la->checks < lb->checks ? 1 : -1;
+  }
+  return la->index < lb->index ? -1 : la->index > lb->index;
+}
+
+bool csp_problem_write_profile(const CSPProblem *csp, FILE *stream) {
+  assert(csp_initialised());
+  assert(csp->profile != NULL && csp->profile->statistics != NULL);
+  CSPProfileLine *lines =
+      malloc(csp->num_constraints * sizeof(CSPProfileLine));
+  if (lines == NULL) {
+    return false;
+  }
+  for (size_t i = 0; i < csp->num_constraints; i++) {
+    lines[i].index = i;
+    lines[i].time = csp_problem_get_profile_time(csp, i);
+    lines[i].checks = csp->profile->statistics[i].checks;
+  }
+  qsort(lines, csp->num_constraints, sizeof(CSPProfileLine),
+        _csp_compare_lines);
+  bool result = fprintf(stream, "%10s %14s %14s %14s\n", "constraint",
+                        "checks", "failures", "time (s)") >= 0;
+  for (size_t i = 0; i < csp->num_constraints && result; i++) {
+    result = fprintf(stream, "%10zu %14zu %14zu %14.9f\n", lines[i].index,
+                     lines[i].checks,
+                     csp->profile->statistics[lines[i].index].failures,
+                     lines[i].time) >= 0;
+  }
+  free(lines);
+  result = result && fprintf(stream, "\n%10s %14s\n", "depth", "nodes") >= 0;
+  for (size_t i = 0; i < csp->num_domains && result; i++) {
+    result = fprintf(stream, "%10zu %14zu\n", i,
+                     csp_problem_get_profile_nodes(csp, i)) >= 0;
+  }
+  return result;
+}
+
+bool csp_problem_write_profile_folded(const CSPProblem *csp, FILE *stream) {
+  assert(csp_initialised());
+  assert(csp->profile != NULL && csp->profile->statistics != NULL);
+  bool result = true;
+  for (size_t i = 0; i < csp->num_constraints && result; i++) {
+    size_t nanoseconds = (size_t)(csp_problem_get_profile_time(csp, i) * 1e9);
+    if (nanoseconds) {
+      result = fprintf(stream, "csp;variable %zu;constraint %zu %zu\n",
+                       _csp_last_position(csp->constraints[i], NULL), i,
+                       nanoseconds) >= 0;
+    }
+  }
+  return result;
 }
 
 bool csp_problem_is_consistent(const CSPProblem *csp, const size_t *values,
@@ -200,20 +961,265 @@ bool csp_problem_is_consistent(const CSPProblem *csp, const size_t *values,
   assert(csp_initialised());
   // Check all constraints
   for (size_t i = 0; i < csp->num_constraints; i++) {
-    CSPConstraint *constraint = csp->constraints[i];
     // Verify if the constraint has to be checked and check it
-    if (csp_constraint_to_check(constraint, index) &&
-        !constraint->check(constraint, values, data)) {
+    if (csp_constraint_to_check(csp->constraints[i], index) &&
+        !_csp_constraint_check(csp, i, values, data)) {
       return false;
     }
   }
   return true;
 }
 
+// Find the representative of a variable in the union-find forest
+static size_t _csp_find(size_t *parent, size_t variable) {
+  while (parent[variable] != variable) {
+    parent[variable] = parent[parent[variable]];
+    variable = parent[variable];
+  }
+  return variable;
+}
+
+// Free the arrays of a decomposition
+static void _csp_decomposition_free(CSPDecomposition *decomposition) {
+  free(decomposition->components);
+  free(decomposition->order);
+  free(decomposition->buckets);
+  free(decomposition->constraints);
+}
+
+
+// Compute the connected components of the constraint graph
+static bool _csp_decompose(const CSPProblem *csp,
+                           CSPDecomposition *decomposition) {
+  size_t n = csp->num_domains;
+  decomposition->num_components = 0;
+  decomposition->components = malloc((n + 1) * sizeof(size_t));
+  decomposition->order = malloc(n * sizeof(size_t));
+  decomposition->buckets = calloc(n + 1, sizeof(size_t));
+  decomposition->constraints = malloc(csp->num_constraints * sizeof(size_t));
+  size_t *root = malloc(n * sizeof(size_t));
+  size_t *start = calloc(n, sizeof(size_t));
+  size_t *position = malloc(n * sizeof(size_t));
+  if (decomposition->components == NULL || decomposition->order == NULL ||
+      decomposition->buckets == NULL || decomposition->constraints == NULL ||
+      root == NULL || start == NULL || position == NULL) {
+    _csp_decomposition_free(decomposition);
+    free(root);
+    free(start);
+    free(position);
+    return false;
+  }
+  // Merge the variables of each constraint
+  for (size_t i = 0; i < n; i++) {
+    root[i] = i;
+  }
+  for (size_t i = 0; i < csp->num_constraints; i++) {
+    const CSPConstraint *constraint = csp->constraints[i];
+    assert(constraint != NULL);
+    size_t first = _csp_find(root, constraint->variables[0]);
+    for (size_t j = 1; j < constraint->arity; j++) {
+      size_t other = _csp_find(root, constraint->variables[j]);
+      if (other < first) {
+        root[first] = other;
+        first = other;
+      } else {
+        root[other] = first;
+      }
+    }
+  }
+  // Count the variables of each component
+  for (size_t i = 0; i < n; i++) {
+    root[i] = _csp_find(root, i);
+    if (!start[root[i]]++) {
+      decomposition->num_components++;
+    }
+  }
+  // Sort the roots by decreasing component size using a counting sort
+  size_t *count = decomposition->buckets;
+  for (size_t i = 0; i < n; i++) {
+    if (root[i] == i) {
+      count[n - start[i]]++;
+    }
+  }
+  for (size_t i = 0, offset = 0; i <= n; i++) {
+    size_t size = count[i];
+    count[i] = offset;
+    offset += size;
+  }
+  size_t *roots = position;
+  for (size_t i = 0; i < n; i++) {
+    if (root[i] == i) {
+      roots[count[n - start[i]]++] = i;
+    }
+  }
+  // Compute the offsets of the components
+  for (size_t c = 0, offset = 0; c < decomposition->num_components; c++) {
+    size_t size = start[roots[c]];
+    decomposition->components[c] = offset;
+    start[roots[c]] = offset;
+    offset += size;
+  }
+  decomposition->components[decomposition->num_components] = n;
+  // Place the variables in ascending order inside each component
+  for (size_t i = 0; i < n; i++) {
+    position[i] = start[root[i]]++;
+    decomposition->order[position[i]] = i;
+  }
+  free(root);
+  free(start);
+  _csp_group_constraints(csp, position, decomposition->buckets,
+                         decomposition->constraints);
+  free(position);
+  return true;
+}
+
+/**
+ * @brief The state shared by the threads solving the components.
+ * @var csp The CSP problem to solve.
+ * @var decomposition The components of the CSP problem.
+ * @var values The values of the variables.
+ * @var data The data to pass to the check function.
+ * @var next The next component to solve.
+ * @var failed true if a component has no solution.
+ */
+typedef struct {
+  const CSPProblem *csp;
+  const CSPDecomposition *decomposition;
+  size_t *values;
+  const void *data;
+  atomic_size_t next;
+  atomic_bool failed;
+} CSPSolveTask;
+
+// Solve the component whose variables are between the start and the end
+// positions, counting the nodes at each depth of the component (if nodes is
+// not NULL). The search is iterative: it backtracks by walking back through
+// the order and resumes each variable from its current value, so that large
+// components do not overflow the thread stacks.
+static bool _csp_component_backtrack(CSPSolveTask *task, size_t start,
+                                     size_t end, size_t *nodes) {
+  const CSPProblem *csp = task->csp;
+  const CSPDecomposition *decomposition = task->decomposition;
+  size_t *values = task->values;
+  size_t position = start;
+  size_t variable = decomposition->order[position];
+  values[variable] = _csp_domain_next(&csp->domains[variable], 0);
+  for (;;) {
+    if (values[variable] == CSP_NONE) {
+      // The domain of the variable is exhausted, backtrack
+      if (position == start) {
+        return false;
+      }
+      variable = decomposition->order[--position];
+      values[variable] =
+          _csp_domain_next(&csp->domains[variable], values[variable] + 1);
+      continue;
+    }
+    // Stop if another component has no solution
+    if (atomic_load_explicit(&task->failed, memory_order_relaxed)) {
+      return false;
+    }
+    if (nodes != NULL) {
+      nodes[position - start]++;
+    }
+    // Only the constraints completed by this variable have to be checked
+    if (!_csp_bucket_check(csp, decomposition->buckets,
+                           decomposition->constraints, position, values,
+                           task->data)) {
+      values[variable] =
+          _csp_domain_next(&csp->domains[variable], values[variable] + 1);
+    } else if (position + 1 == end) {
+      // All the variables of the component are assigned
+      return true;
+    } else {
+      variable = decomposition->order[++position];
+      values[variable] = _csp_domain_next(&csp->domains[variable], 0);
+    }
+  }
+}
+
+// Solve the components until all are solved or one has no solution
+static void *_csp_solve_worker(void *arg) {
+  CSPSolveTask *task = arg;
+  const CSPDecomposition *decomposition = task->decomposition;
+  CSPProfile *profile = task->csp->profile;
+  // The nodes are counted in a histogram of the thread, sized for the largest
+  // component, and merged after each component. The positions of a component
+  // are only counted by its thread, so the histogram of the profile can
+  // also be used directly if the allocation fails.
+  size_t *local = NULL;
+  if (profile != NULL) {
+    local = calloc(decomposition->components[1], sizeof(size_t));
+  }
+  for (;;) {
+    size_t c = atomic_fetch_add(&task->next, 1);
+    if (c >= decomposition->num_components ||
+        atomic_load_explicit(&task->failed, memory_order_relaxed)) {
+      break;
+    }
+    size_t start = decomposition->components[c];
+    size_t end = decomposition->components[c + 1];
+    size_t *nodes = NULL;
+    if (profile != NULL) {
+      nodes = local != NULL ? local : profile->nodes + start;
+    }
+    if (!_csp_component_backtrack(task, start, end, nodes)) {
+      atomic_store(&task->failed, true);
+    }
+    if (local != NULL) {
+      for (size_t i = start; i < end; i++) {
+        profile->nodes[i] += local[i - start];
+      }
+      memset(local, 0, (end - start) * sizeof(size_t));
+    }
+  }
+  free(local);
+  return NULL;
+}
+
 bool csp_problem_solve(const CSPProblem *csp, size_t *values,
                        const void *data) {
   assert(csp_initialised());
-  return csp_problem_backtrack(csp, values, data, 0);
+  CSPDecomposition decomposition;
+  if (!_csp_decompose(csp, &decomposition)) {
+    // Fall back to the plain search
+    return csp_problem_backtrack(csp, values, data, 0);
+  }
+  CSPSolveTask task = {.csp = csp,
+                       .decomposition = &decomposition,
+                       .values = values,
+                       .data = data};
+  atomic_init(&task.next, 0);
+  atomic_init(&task.failed, false);
+  // Use at most one thread per component
+  size_t num_threads = csp->num_threads;
+  if (!num_threads) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    num_threads = online > 0 ? (size_t)online : 1;
+  }
+  if (num_threads > decomposition.num_components) {
+    num_threads = decomposition.num_components;
+  }
+  pthread_t *threads = NULL;
+  size_t started = 0;
+  if (num_threads > 1) {
+    threads = malloc((num_threads - 1) * sizeof(pthread_t));
+    if (threads != NULL) {
+      while (started < num_threads - 1 &&
+             !pthread_create(&threads[started], NULL, _csp_solve_worker,
+                             &task)) {
+        started++;
+      }
+    }
+  }
+  // The calling thread takes part in the search
+  _csp_solve_worker(&task);
+  while (started--) {
+    pthread_join(threads[started], NULL);
+  }
+  free(threads);
+  _csp_decomposition_free(&decomposition);
+  return !atomic_load(&task.failed);
 }
 
 bool csp_problem_backtrack(const CSPProblem *csp, size_t *values,
@@ -224,9 +1230,12 @@ bool csp_problem_backtrack(const CSPProblem *csp, size_t *values,
     return true;
   }
   // Try all values in the domain of the current variable
-  for (size_t i = 0; i < csp->domains[index]; i++) {
+  const CSPDomain *domain = &csp->domains[index];
+  for (size_t i = _csp_domain_next(domain, 0); i != CSP_NONE;
+       i = _csp_domain_next(domain, i + 1)) {
     // Assign the value to the variable
     values[index] = i;
+    _csp_profile_node(csp, index);
     // Check if the assignment is consistent with the constraints
     if (csp_problem_is_consistent(csp, values, data, index + 1) &&
         csp_problem_backtrack(csp, values, data, index + 1)) {
@@ -235,3 +1244,663 @@ bool csp_problem_backtrack(const CSPProblem *csp, size_t *values,
   }
   return false;
 }
+
+/**
+ * @brief The state of a branch-and-bound search.
+ * @var csp The CSP problem to optimise.
+ * @var values The values of the variables.
+ * @var data The data to pass to the callbacks.
+ * @var buckets The offsets in the constraints of each variable.
+ * @var constraints The indices of the constraints grouped by their last
+ * variable.
+ * @var objective The objective function (NULL for a weighted sum).
+ * @var weights The weights of the variables of a weighted sum.
+ * @var remaining The lower bounds of the weighted sum of the last variables.
+ * @var report The function reporting the improving solutions.
+ * @var best The values of the best solution.
+ * @var cost The cost of the best solution.
+ * @var found true if a solution has been found.
+ * @var stopped true if the search has been stopped.
+ * @var limited true if the search has a deadline.
+ * @var deadline The deadline of the search.
+ * @var nodes The number of values tried.
+ */
+typedef struct {
+  const CSPProblem *csp;
+  size_t *values;
+  const void *data;
+  size_t *buckets;
+  size_t *constraints;
+  CSPObjective *objective;
+  const double *weights;
+  double *remaining;
+  CSPReporter *report;
+  size_t *best;
+  double cost;
+  bool found;
+  bool stopped;
+  bool limited;
+  struct timespec deadline;
+  size_t nodes;
+} CSPOptimiseTask;
+
+// Verify if the deadline of the search is reached (every 1024 values tried)
+static bool _csp_optimise_expired(CSPOptimiseTask *task) {
+  if (!task->limited || ++task->nodes % 1024) {
+    return false;
+  }
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec > task->deadline.tv_sec ||
+         (now.tv_sec == task->deadline.tv_sec &&
+          now.tv_nsec >= task->deadline.tv_nsec);
+}
+
+// Explore the assignments of the variables from the specified index
+static void _csp_optimise_backtrack(CSPOptimiseTask *task, size_t index,
+                                    double partial) {
+  const CSPProblem *csp = task->csp;
+  // Try all values in the domain of the current variable, each of them
+  // counting as a node towards the deadline
+  const CSPDomain *domain = &csp->domains[index];
+  for (size_t i = _csp_domain_next(domain, 0); i != CSP_NONE && !task->stopped;
+       i = _csp_domain_next(domain, i + 1)) {
+    if (_csp_optimise_expired(task)) {
+      task->stopped = true;
+      break;
+    }
+    task->values[index] = i;
+    _csp_profile_node(csp, index);
+    // Only the constraints completed by this variable have to be checked
+    if (!_csp_bucket_check(csp, task->buckets, task->constraints, index,
+                           task->values, task->data)) {
+      continue;
+    }
+    // Prune the subtree if its bound cannot beat the best solution
+    double sum = 0;
+    double bound;
+    if (task->objective != NULL) {
+      bound = task->objective(csp, task->values, task->data, index + 1);
+    } else {
+      sum = partial + task->weights[index] * (double)i;
+      bound = sum + task->remaining[index + 1];
+    }
+    if (task->found && bound >= task->cost) {
+      continue;
+    }
+    if (index + 1 < csp->num_domains) {
+      _csp_optimise_backtrack(task, index + 1, sum);
+    } else {
+      // The bound of a complete assignment is its cost
+      memcpy(task->best, task->values, csp->num_domains * sizeof(size_t));
+      task->cost = bound;
+      task->found = true;
+      if (task->report != NULL &&
+          !task->report(csp, task->values, bound, task->data)) {
+        task->stopped = true;
+      }
+    }
+  }
+}
+
+// Run a branch-and-bound search
+static bool _csp_optimise(CSPOptimiseTask *task, double time_limit,
+                          double *cost, bool *optimal) {
+  const CSPProblem *csp = task->csp;
+  size_t n = csp->num_domains;
+  task->buckets = malloc((n + 1) * sizeof(size_t));
+  task->constraints = malloc(csp->num_constraints * sizeof(size_t));
+  task->best = malloc(n * sizeof(size_t));
+  if (task->buckets == NULL || task->constraints == NULL ||
+      task->best == NULL) {
+    free(task->buckets);
+    free(task->constraints);
+    free(task->best);
+    if (optimal != NULL) {
+      *optimal = false;
+    }
+    return false;
+  }
+  _csp_group_constraints(csp, NULL, task->buckets, task->constraints);
+  task->found = false;
+  task->stopped = false;
+  task->nodes = 0;
+  task->limited = time_limit > 0;
+  if (task->limited) {
+    clock_gettime(CLOCK_MONOTONIC, &task->deadline);
+    double seconds = (double)task->deadline.tv_sec +
+                     (double)task->deadline.tv_nsec / 1e9 + time_limit;
+    task->deadline.tv_sec = (time_t)seconds;
+    task->deadline.tv_nsec =
+        (long)((seconds - (double)task->deadline.tv_sec) * 1e9);
+  }
+  _csp_optimise_backtrack(task, 0, 0);
+  if (task->found) {
+    memcpy(task->values, task->best, n * sizeof(size_t));
+    if (cost != NULL) {
+      *cost = task->cost;
+    }
+  }
+  // The search is complete unless it has been stopped
+  if (optimal != NULL) {
+    *optimal = !task->stopped;
+  }
+  free(task->buckets);
+  free(task->constraints);
+  free(task->best);
+  return task->found;
+}
+
+bool csp_problem_minimise(const CSPProblem *csp, size_t *values,
+                          const void *data, CSPObjective *objective,
+                          CSPReporter *report, double time_limit,
+                          double *cost, bool *optimal) {
+  assert(csp_initialised());
+  assert(objective != NULL);
+  CSPOptimiseTask task = {.csp = csp,
+                          .values = values,
+                          .data = data,
+                          .objective = objective,
+                          .report = report};
+  return _csp_optimise(&task, time_limit, cost, optimal);
+}
+
+bool csp_problem_minimise_linear(const CSPProblem *csp, size_t *values,
+                                 const void *data, const double *weights,
+                                 CSPReporter *report, double time_limit,
+                                 double *cost, bool *optimal) {
+  assert(csp_initialised());
+  assert(weights != NULL);
+  size_t n = csp->num_domains;
+  // The lowest contribution of each variable is reached at one end of its
+  // domain
+  double *remaining = malloc((n + 1) * sizeof(double));
+  if (remaining == NULL) {
+    if (optimal != NULL) {
+      *optimal = false;
+    }
+    return false;
+  }
+  remaining[n] = 0;
+  for (size_t i = n; i-- > 0;) {
+    const CSPDomain *domain = &csp->domains[i];
+    double end = weights[i] * (double)(weights[i] < 0 ? domain->max
+                                                       : domain->min);
+    remaining[i] = remaining[i + 1] + (domain->size ? end : 0);
+  }
+  CSPOptimiseTask task = {.csp = csp,
+                          .values = values,
+                          .data = data,
+                          .weights = weights,
+                          .remaining = remaining,
+                          .report = report};
+  bool result = _csp_optimise(&task, time_limit, cost, optimal);
+  free(remaining);
+  return result;
+}
+
+// Root the search at the specified depth, the first values being fixed
+static void _csp_search_root(CSPSearch *search, const size_t *prefix,
+                             size_t depth) {
+  assert(depth < search->csp->num_domains);
+  if (depth) {
+    memcpy(search->values, prefix, depth * sizeof(size_t));
+  }
+  search->values[depth] = _csp_domain_next(&search->csp->domains[depth], 0);
+  search->first = depth;
+  search->index = depth;
+  search->solved = false;
+  search->finished = false;
+}
+
+// Run the search until the next solution, the end of the search or the
+// exhaustion of the budget of nodes (if not NULL)
+static bool _csp_search_run(CSPSearch *search, size_t *values,
+                            size_t *budget) {
+  const CSPProblem *csp = search->csp;
+  size_t n = csp->num_domains;
+  if (search->finished) {
+    return false;
+  }
+  size_t index = search->index;
+  if (search->solved) {
+    // Resume with the next value of the last variable of the solution
+    search->values[index] =
+        _csp_domain_next(&csp->domains[index], search->values[index] + 1);
+    search->solved = false;
+  }
+  for (;;) {
+    if (search->values[index] == CSP_NONE) {
+      // The domain of the variable is exhausted, backtrack
+      if (index == search->first) {
+        search->finished = true;
+        return false;
+      }
+      index--;
+      search->values[index] =
+          _csp_domain_next(&csp->domains[index], search->values[index] + 1);
+      continue;
+    }
+    if (budget != NULL && !(*budget)--) {
+      // Suspend the search before this node
+      *budget = 0;
+      search->index = index;
+      return false;
+    }
+    _csp_profile_node(csp, index);
+    // Only the constraints completed by this variable have to be checked
+    if (!_csp_bucket_check(csp, search->buckets, search->constraints, index,
+                           search->values, search->data)) {
+      search->values[index] =
+          _csp_domain_next(&csp->domains[index], search->values[index] + 1);
+    } else if (index + 1 < n) {
+      index++;
+      search->values[index] = _csp_domain_next(&csp->domains[index], 0);
+    } else {
+      // All variables are assigned, suspend the search on this solution
+      search->index = index;
+      search->solved = true;
+      memcpy(values, search->values, n * sizeof(size_t));
+      return true;
+    }
+  }
+}
+
+CSPSearch *csp_search_begin(const CSPProblem *csp, const void *data) {
+  assert(csp_initialised());
+  CSPSearch *search = malloc(sizeof(CSPSearch));
+  if (search != NULL) {
+    search->values = calloc(csp->num_domains, sizeof(size_t));
+    search->buckets = malloc((csp->num_domains + 1) * sizeof(size_t));
+    search->constraints = malloc(csp->num_constraints * sizeof(size_t));
+    if (search->values != NULL && search->buckets != NULL &&
+        search->constraints != NULL) {
+      _csp_group_constraints(csp, NULL, search->buckets, search->constraints);
+      search->csp = csp;
+      search->data = data;
+      _csp_search_root(search, NULL, 0);
+    } else {
+      csp_search_end(search);
+      search = NULL;
+    }
+  }
+  return search;
+}
+
+bool csp_search_next(CSPSearch *search, size_t *values) {
+  assert(csp_initialised());
+  assert(search != NULL);
+  return _csp_search_run(search, values, NULL);
+}
+
+void csp_search_end(CSPSearch *search) {
+  assert(csp_initialised());
+  assert(search != NULL);
+  free(search->values);
+  free(search->buckets);
+  free(search->constraints);
+  free(search);
+}
+
+// The width of a number in a work file (including a leading space)
+#define CSP_CUBE_WIDTH 21
+// The offset of the number of variables in a work file
+#define CSP_CUBE_HEADER (sizeof("csp-cubes") - 1)
+// The offset of the next cube to solve in a work file
+#define CSP_CUBE_NEXT \
+  (CSP_CUBE_HEADER + 3 * CSP_CUBE_WIDTH + 1 + sizeof("next") - 1)
+// The offset of the status (1 if solved) in a work file
+#define CSP_CUBE_STATUS \
+  (CSP_CUBE_NEXT + CSP_CUBE_WIDTH + 1 + sizeof("status") - 1)
+// The offset of the number of completed cubes in a work file
+#define CSP_CUBE_DONE \
+  (CSP_CUBE_STATUS + CSP_CUBE_WIDTH + 1 + sizeof("done") - 1)
+// The offset of the solution in a work file
+#define CSP_CUBE_SOLUTION \
+  (CSP_CUBE_DONE + CSP_CUBE_WIDTH + 1 + sizeof("solution") - 1)
+// The number of nodes explored between two checks of the status
+#define CSP_CUBE_BUDGET 4096
+
+// Read a number at the specified offset of a work file
+static bool _csp_cube_read(int fd, size_t offset, size_t *value) {
+  char buffer[CSP_CUBE_WIDTH + 1];
+  if (pread(fd, buffer, CSP_CUBE_WIDTH, (off_t)offset) != CSP_CUBE_WIDTH) {
+    return false;
+  }
+  buffer[CSP_CUBE_WIDTH] = '\0';
+  return sscanf(buffer, "%zu", value) == 1;
+}
+
+// Write a number at the specified offset of a work file
+static bool _csp_cube_write(int fd, size_t offset, size_t value) {
+  char buffer[CSP_CUBE_WIDTH + 1];
+  snprintf(buffer, sizeof(buffer), "%21zu", value);
+  return pwrite(fd, buffer, CSP_CUBE_WIDTH, (off_t)offset) == CSP_CUBE_WIDTH;
+}
+
+// Lock or unlock a work file against the other processes
+static bool _csp_cube_lock(int fd, bool lock) {
+  struct flock region = {.l_type = lock ? F_WRLCK : F_UNLCK,
+                         .l_whence = SEEK_SET};
+  return fcntl(fd, F_SETLKW, &region) == 0;
+}
+
+// Read the number of variables, the depth and the number of cubes of a work
+// file
+static bool _csp_cube_header(int fd, size_t *num_domains, size_t *depth,
+                             size_t *count) {
+  return _csp_cube_read(fd, CSP_CUBE_HEADER, num_domains) &&
+         _csp_cube_read(fd, CSP_CUBE_HEADER + CSP_CUBE_WIDTH, depth) &&
+         _csp_cube_read(fd, CSP_CUBE_HEADER + 2 * CSP_CUBE_WIDTH, count);
+}
+
+// Claim the next cube of a work file if it is not solved
+static bool _csp_cube_claim(int fd, size_t count, size_t *cube) {
+  size_t status;
+  bool claimed = false;
+  if (_csp_cube_lock(fd, true)) {
+    claimed = _csp_cube_read(fd, CSP_CUBE_STATUS, &status) && !status &&
+              _csp_cube_read(fd, CSP_CUBE_NEXT, cube) && *cube < count &&
+              _csp_cube_write(fd, CSP_CUBE_NEXT, *cube + 1);
+    _csp_cube_lock(fd, false);
+  }
+  return claimed;
+}
+
+// Count a cube of a work file as completed
+static bool _csp_cube_complete(int fd) {
+  size_t done;
+  bool completed = false;
+  if (_csp_cube_lock(fd, true)) {
+    completed = _csp_cube_read(fd, CSP_CUBE_DONE, &done) &&
+                _csp_cube_write(fd, CSP_CUBE_DONE, done + 1);
+    _csp_cube_lock(fd, false);
+  }
+  return completed;
+}
+
+// Get the outcome of a work file, reading its solution if it is solved
+static CSPCubeResult _csp_cube_outcome(int fd, size_t *values) {
+  size_t n, depth, count, status, done;
+  if (!_csp_cube_header(fd, &n, &depth, &count) ||
+      !_csp_cube_read(fd, CSP_CUBE_STATUS, &status) ||
+      !_csp_cube_read(fd, CSP_CUBE_DONE, &done)) {
+    return CSP_CUBE_INCOMPLETE;
+  }
+  if (status) {
+    for (size_t i = 0; i < n; i++) {
+      if (!_csp_cube_read(fd, CSP_CUBE_SOLUTION + i * CSP_CUBE_WIDTH,
+                          &values[i])) {
+        return CSP_CUBE_INCOMPLETE;
+      }
+    }
+    return CSP_CUBE_SOLVED;
+  }
+  return done == count ? CSP_CUBE_UNSATISFIABLE : CSP_CUBE_INCOMPLETE;
+}
+
+// Verify if the variable at the specified index has a value consistent with
+// the constraints it completes
+static bool _csp_cube_lookahead(const CSPProblem *csp, size_t *values,
+                                const void *data, const size_t *buckets,
+                                const size_t *constraints, size_t index) {
+  const CSPDomain *domain = &csp->domains[index];
+  for (size_t i = _csp_domain_next(domain, 0); i != CSP_NONE;
+       i = _csp_domain_next(domain, i + 1)) {
+    values[index] = i;
+    if (_csp_bucket_check(csp, buckets, constraints, index, values, data)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Write a work file
+static bool _csp_cube_dump(const char *path, size_t num_domains, size_t depth,
+                           size_t count, const size_t *cubes) {
+  FILE *stream = fopen(path, "w");
+  if (stream == NULL) {
+    return false;
+  }
+  bool result = fprintf(stream, "csp-cubes%21zu%21zu%21zu\nnext%21zu\n"
+                        "status%21zu\ndone%21zu\nsolution", num_domains,
+                        depth, count, (size_t)0, (size_t)0, (size_t)0) >= 0;
+  for (size_t i = 0; i < num_domains && result; i++) {
+    result = fprintf(stream, "%21zu", (size_t)0) >= 0;
+  }
+  result = result && fputc('\n', stream) != EOF;
+  for (size_t c = 0; c < count && result; c++) {
+    for (size_t i = 0; i < depth && result; i++) {
+      result = fprintf(stream, "%21zu", cubes[c * depth + i]) >= 0;
+    }
+    result = result && fputc('\n', stream) != EOF;
+  }
+  return fclose(stream) == 0 && result;
+}
+
+bool csp_cube_split(const CSPProblem *csp, const void *data, size_t num_cubes,
+                    const char *path, size_t *count) {
+  assert(csp_initialised());
+  size_t n = csp->num_domains;
+  size_t *buckets = malloc((n + 1) * sizeof(size_t));
+  size_t *constraints = malloc(csp->num_constraints * sizeof(size_t));
+  size_t *values = malloc(n * sizeof(size_t));
+  // The root cube is the empty assignment
+  size_t *cubes = malloc(sizeof(size_t));
+  size_t num = 1;
+  size_t depth = 0;
+  bool result = buckets != NULL && constraints != NULL && values != NULL &&
+                cubes != NULL;
+  if (result) {
+    _csp_group_constraints(csp, NULL, buckets, constraints);
+    if (!_csp_cube_lookahead(csp, values, data, buckets, constraints, 0)) {
+      num = 0;
+    }
+  }
+  // Extend the cubes with the values of the next variable. Most candidates
+  // are filtered out, so the buffer only grows with the kept cubes.
+  while (result && num && num < num_cubes && depth < n) {
+    const CSPDomain *domain = &csp->domains[depth];
+    size_t width = (depth + 1) * sizeof(size_t);
+    size_t *next = NULL;
+    size_t capacity = 0;
+    size_t extended = 0;
+    for (size_t c = 0; result && c < num; c++) {
+      memcpy(values, cubes + c * depth, depth * sizeof(size_t));
+      for (size_t i = _csp_domain_next(domain, 0); i != CSP_NONE;
+           i = _csp_domain_next(domain, i + 1)) {
+        values[depth] = i;
+        if (!_csp_bucket_check(csp, buckets, constraints, depth, values,
+                               data) ||
+            (depth + 1 < n &&
+             !_csp_cube_lookahead(csp, values, data, buckets, constraints,
+                                  depth + 1))) {
+          continue;
+        }
+        if (extended == capacity) {
+          // Double the capacity, failing if its size overflows
+          size_t grown = capacity ? 2 * capacity : num;
+          size_t *resized = grown > capacity && grown <= SIZE_MAX / width
+                                ? realloc(next, grown * width)
+                                : NULL;
+          if (resized == NULL) {
+            result = false;
+            break;
+          }
+          next = resized;
+          capacity = grown;
+        }
+        memcpy(next + extended++ * (depth + 1), values, width);
+      }
+    }
+    free(cubes);
+    cubes = next;
+    num = extended;
+    depth++;
+  }
+  result = result && _csp_cube_dump(path, n, depth, num, cubes);
+  if (result && count != NULL) {
+    *count = num;
+  }
+  free(buckets);
+  free(constraints);
+  free(values);
+  free(cubes);
+  return result;
+}
+
+CSPCubeResult csp_cube_work(const CSPProblem *csp, size_t *values,
+                            const void *data, const char *path) {
+  assert(csp_initialised());
+  int fd = open(path, O_RDWR);
+  if (fd < 0) {
+    return CSP_CUBE_INCOMPLETE;
+  }
+  size_t n, depth, count;
+  if (!_csp_cube_header(fd, &n, &depth, &count) || n != csp->num_domains ||
+      depth > n) {
+    close(fd);
+    return CSP_CUBE_INCOMPLETE;
+  }
+  size_t size = depth * CSP_CUBE_WIDTH + 1;
+  size_t start = CSP_CUBE_SOLUTION + n * CSP_CUBE_WIDTH + 1;
+  CSPSearch *search = depth < n ? csp_search_begin(csp, data) : NULL;
+  char *record = malloc(size + 1);
+  bool found = false;
+  bool stopped = (depth < n && search == NULL) || record == NULL;
+  size_t cube;
+  // A claimed cube is only completed once refuted, so that the cubes of a
+  // failing worker are not mistaken for refuted ones
+  while (!found && !stopped && _csp_cube_claim(fd, count, &cube)) {
+    // Read the values of the cube
+    off_t offset = (off_t)(start + cube * size);
+    if (pread(fd, record, size, offset) != (ssize_t)size) {
+      break;
+    }
+    record[size] = '\0';
+    char *cursor = record;
+    for (size_t i = 0; i < depth; i++) {
+      values[i] = strtoul(cursor, &cursor, 10);
+    }
+    if (!csp_problem_is_consistent(csp, values, data, depth)) {
+      stopped = !_csp_cube_complete(fd);
+      continue;
+    }
+    if (depth == n) {
+      found = true;
+      break;
+    }
+    // Search the cube, checking the status between two runs
+    _csp_search_root(search, values, depth);
+    for (;;) {
+      size_t budget = CSP_CUBE_BUDGET;
+      size_t status;
+      if (_csp_search_run(search, values, &budget)) {
+        found = true;
+        break;
+      }
+      if (search->finished) {
+        stopped = !_csp_cube_complete(fd);
+        break;
+      }
+      if (!_csp_cube_read(fd, CSP_CUBE_STATUS, &status) || status) {
+        stopped = true;
+        break;
+      }
+    }
+  }
+  // Record the solution if it is the first one
+  if (found && _csp_cube_lock(fd, true)) {
+    size_t status;
+    if (_csp_cube_read(fd, CSP_CUBE_STATUS, &status) && !status) {
+      for (size_t i = 0; i < n; i++) {
+        _csp_cube_write(fd, CSP_CUBE_SOLUTION + i * CSP_CUBE_WIDTH, values[i]);
+      }
+      _csp_cube_write(fd, CSP_CUBE_STATUS, 1);
+    }
+    _csp_cube_lock(fd, false);
+  }
+  if (search != NULL) {
+    csp_search_end(search);
+  }
+  free(record);
+  CSPCubeResult result =
+      found ? CSP_CUBE_SOLVED : _csp_cube_outcome(fd, values);
+  close(fd);
+  return result;
+}
+
+bool csp_cube_solution(const char *path, size_t *values) {
+  assert(csp_initialised());
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  bool result = _csp_cube_outcome(fd, values) == CSP_CUBE_SOLVED;
+  close(fd);
+  return result;
+}
+
+CSPCubeResult csp_cube_solve(const CSPProblem *csp, size_t *values,
+                             const void *data, const char *path,
+                             size_t num_cubes, size_t num_workers) {
+  assert(csp_initialised());
+  assert(num_workers > 0);
+  size_t count;
+  if (!csp_cube_split(csp, data, num_cubes, path, &count)) {
+    return CSP_CUBE_INCOMPLETE;
+  }
+  if (!count) {
+    return CSP_CUBE_UNSATISFIABLE;
+  }
+  if (num_workers > count) {
+    num_workers = count;
+  }
+  // The workers share a process group to be stopped together
+  fflush(NULL);
+  pid_t group = 0;
+  size_t started = 0;
+  while (started < num_workers) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      setpgid(0, group);
+      _exit(csp_cube_work(csp, values, data, path) == CSP_CUBE_SOLVED
+                ? EXIT_SUCCESS
+                : EXIT_FAILURE);
+    }
+    if (pid < 0) {
+      break;
+    }
+    setpgid(pid, group);
+    if (!group) {
+      group = pid;
+    }
+    started++;
+  }
+  if (!started) {
+    // Solve the cubes in this process
+    return csp_cube_work(csp, values, data, path);
+  }
+  // Collect the workers and stop them at the first solution
+  bool solved = false;
+  while (started) {
+    int status;
+    pid_t pid = waitpid(-group, &status, 0);
+    if (pid < 0) {
+      break;
+    }
+    started--;
+    if (!solved && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS) {
+      solved = true;
+      kill(-group, SIGTERM);
+    }
+  }
+  // The cubes of the failed workers are left uncompleted
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return CSP_CUBE_INCOMPLETE;
+  }
+  CSPCubeResult result = _csp_cube_outcome(fd, values);
+  close(fd);
+  return result;
+}
@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 
 /**
  * @brief The constraint of a CSP problem.
@@ -12,6 +13,10 @@ typedef struct _CSPConstraint CSPConstraint;
  * @brief The CSP problem.
  */
 typedef struct _CSPProblem CSPProblem;
+/**
+ * @brief The resumable search of the solutions of a CSP problem.
+ */
+typedef struct _CSPSearch CSPSearch;
 /**
  * @brief The check function of a CSP constraint.
  * @param constraint The constraint to check.
@@ -22,6 +27,43 @@ typedef struct _CSPProblem CSPProblem;
  * @pre values != NULL
  */
 typedef bool CSPChecker(const CSPConstraint *, const size_t *, const void *);
+/**
+ * @brief The objective function of a CSP optimisation.
+ * @param csp The CSP problem to optimise.
+ * @param values The values of the variables.
+ * @param data The data to pass to the objective function.
+ * @param index The number of assigned variables.
+ * @return A lower bound of the cost of any solution extending the values of
+ * the first index variables, the cost of the solution if index is the number
+ * of variables.
+ * @pre csp != NULL
+ * @pre values != NULL
+ */
+typedef double CSPObjective(const CSPProblem *, const size_t *, const void *, size_t);
+/**
+ * @brief The function reporting the improving solutions of a CSP optimisation.
+ * @param csp The CSP problem to optimise.
+ * @param values The values of the variables.
+ * @param cost The cost of the solution.
+ * @param data The data to pass to the report function.
+ * @return true to continue the optimisation, false to stop it.
+ * @pre csp != NULL
+ * @pre values != NULL
+ */
+typedef bool CSPReporter(const CSPProblem *, const size_t *, double, const void *);
+/**
+ * @brief The outcome of a cube-and-conquer search.
+ *
+ * CSP_CUBE_UNSATISFIABLE if all the cubes have been completed without
+ * solution, CSP_CUBE_SOLVED if a solution has been found and
+ * CSP_CUBE_INCOMPLETE if some cubes have not been completed (they are still
+ * being solved, or a worker has failed before completing them).
+ */
+typedef enum _CSPCubeResult {
+  CSP_CUBE_UNSATISFIABLE,
+  CSP_CUBE_SOLVED,
+  CSP_CUBE_INCOMPLETE,
+} CSPCubeResult;
 
 /**
  * @brief Initialise the CSP library.
@@ -64,6 +106,38 @@ extern CSPConstraint *csp_constraint_create(size_t arity, CSPChecker *check);
  * @post The constraint is freed.
  */
 extern void csp_constraint_destroy(CSPConstraint *constraint);
+/**
+ * @brief Create an array of constraints with the same arity and check
+ * function in a single allocation.
+ * @param count The number of constraints.
+ * @param arity The arity of the constraints.
+ * @param check The check function of the constraints.
+ * @return The first constraint of the array or NULL if an error occurred.
+ * @pre The csp library is initialised.
+ * @pre count > 0
+ * @pre arity > 0
+ * @pre check != NULL
+ * @post The constraints variables are initialised to 0.
+ */
+extern CSPConstraint *csp_constraints_create(size_t count, size_t arity, CSPChecker *check);
+/**
+ * @brief Get the constraint of an array at the specified index.
+ * @param constraints The array of constraints.
+ * @param index The index of the constraint.
+ * @return The constraint at the specified index.
+ * @pre The csp library is initialised.
+ * @pre index is less than the number of constraints of the array.
+ */
+extern CSPConstraint *csp_constraints_get(CSPConstraint *constraints, size_t index);
+/**
+ * @brief Destroy an array of constraints.
+ * @param constraints The array of constraints to destroy.
+ * @param count The number of constraints of the array.
+ * @pre The csp library is initialised.
+ * @pre constraints has been created by csp_constraints_create.
+ * @post The constraints are freed.
+ */
+extern void csp_constraints_destroy(CSPConstraint *constraints, size_t count);
 /**
  * @brief Get the arity of the constraint.
  * @param constraint The constraint to get the arity.
@@ -105,6 +179,51 @@ extern size_t csp_constraint_get_variable(const CSPConstraint *constraint, size_
  * @pre constraint != NULL
  */
 extern bool csp_constraint_to_check(const CSPConstraint *constraint, size_t index);
+/**
+ * @brief Set the capacity of the result cache of the constraint.
+ *
+ * The cache memoises the result of the check function for each tuple of
+ * values of the constraint variables. It is direct-mapped when the product of
+ * the domain spans (largest value - smallest value + 1) of the constraint
+ * variables fits in the capacity and hashed (replacing entries on collision)
+ * otherwise, so sparse domains may need a larger capacity than their number
+ * of values to be direct-mapped. The check function must
+ * only depend on the values of the constraint variables and on the data.
+ * @param constraint The constraint to set the cache.
+ * @param capacity The maximum number of entries of the cache (0 to disable it).
+ * @return true if the cache is set, false if an error occurred.
+ * @pre The csp library is initialised.
+ * @pre constraint != NULL
+ * @post The cache results and counters are cleared.
+ */
+extern bool csp_constraint_set_cache(CSPConstraint *constraint, size_t capacity);
+/**
+ * @brief Get the capacity of the result cache of the constraint.
+ * @param constraint The constraint to get the cache capacity.
+ * @return The maximum number of entries of the cache (0 if disabled).
+ * @pre The csp library is initialised.
+ */
+extern size_t csp_constraint_get_cache(const CSPConstraint *constraint);
+/**
+ * @brief Clear the results and the counters of the cache of the constraint.
+ * @param constraint The constraint to clear the cache.
+ * @pre The csp library is initialised.
+ */
+extern void csp_constraint_clear_cache(CSPConstraint *constraint);
+/**
+ * @brief Get the number of checks answered by the cache of the constraint.
+ * @param constraint The constraint to get the cache hits.
+ * @return The number of cache hits (0 if the cache is disabled).
+ * @pre The csp library is initialised.
+ */
+extern size_t csp_constraint_get_cache_hits(const CSPConstraint *constraint);
+/**
+ * @brief Get the number of checks not answered by the cache of the constraint.
+ * @param constraint The constraint to get the cache misses.
+ * @return The number of cache misses (0 if the cache is disabled).
+ * @pre The csp library is initialised.
+ */
+extern size_t csp_constraint_get_cache_misses(const CSPConstraint *constraint);
 
 /**
  * @brief Create a CSP problem with the specified number of variables and constraints.
@@ -118,6 +237,7 @@ extern bool csp_constraint_to_check(const CSPConstraint *constraint, size_t inde
  * @post The CSP problem constraints are initialised to NULL.
  * @post The CSP problem number of domains is set to the specified number of domains.
  * @post The CSP problem number of constraints is set to the specified number of constraints.
+ * @post The CSP problem number of threads is set to 1.
  */
 extern CSPProblem *csp_problem_create(size_t num_domains, size_t num_constraints);
 /**
@@ -174,11 +294,215 @@ extern void csp_problem_set_domain(CSPProblem *csp, size_t index, size_t domain)
  * @brief Get the domain of the CSP problem at the specified index.
  * @param csp The CSP problem to get the domain.
  * @param index The index of the domain.
- * @return The domain at the specified index.
+ * @return The number of values of the domain at the specified index.
  * @pre The csp library is initialised.
  * @pre index < csp->num_domains
  */
 extern size_t csp_problem_get_domain(const CSPProblem *csp, size_t index);
+/**
+ * @brief Set the domain of the CSP problem at the specified index to an
+ * interval.
+ * @param csp The CSP problem to set the domain.
+ * @param index The index of the domain.
+ * @param min The smallest value of the domain.
+ * @param max The largest value of the domain.
+ * @pre The csp library is initialised.
+ * @pre index < csp->num_domains
+ * @pre min <= max < SIZE_MAX
+ */
+extern void csp_problem_set_domain_interval(CSPProblem *csp, size_t index, size_t min, size_t max);
+/**
+ * @brief Set the domain of the CSP problem at the specified index to a set of
+ * values.
+ *
+ * The domain is stored as an interval if the values are contiguous, as a
+ * bitset if it is not larger than the sorted list of values, and as the
+ * sorted list otherwise.
+ * @param csp The CSP problem to set the domain.
+ * @param index The index of the domain.
+ * @param values The values of the domain, in any order.
+ * @param count The number of values.
+ * @return true if the domain is set, false if an error occurred.
+ * @pre The csp library is initialised.
+ * @pre index < csp->num_domains
+ * @pre All the values are less than SIZE_MAX.
+ */
+extern bool csp_problem_set_domain_values(CSPProblem *csp, size_t index, const size_t *values, size_t count);
+/**
+ * @brief Get the values of the domain of the CSP problem at the specified
+ * index.
+ * @param csp The CSP problem to get the domain.
+ * @param index The index of the domain.
+ * @param values The array receiving the values in ascending order.
+ * @return The number of values of the domain.
+ * @pre The csp library is initialised.
+ * @pre index < csp->num_domains
+ * @pre values can hold csp_problem_get_domain(csp, index) values.
+ */
+extern size_t csp_problem_get_domain_values(const CSPProblem *csp, size_t index, size_t *values);
+/**
+ * @brief Get the memory allocated for the values of the domain of the CSP
+ * problem at the specified index.
+ * @param csp The CSP problem to get the domain.
+ * @param index The index of the domain.
+ * @return The number of bytes of the list or bitset of the domain (0 for an
+ * interval).
+ * @pre The csp library is initialised.
+ * @pre index < csp->num_domains
+ */
+extern size_t csp_problem_get_domain_memory(const CSPProblem *csp, size_t index);
+/**
+ * @brief Verify if a value is in the domain of the CSP problem at the
+ * specified index.
+ * @param csp The CSP problem to verify.
+ * @param index The index of the domain.
+ * @param value The value to verify.
+ * @return true if the value is in the domain, false otherwise.
+ * @pre The csp library is initialised.
+ * @pre index < csp->num_domains
+ */
+extern bool csp_problem_in_domain(const CSPProblem *csp, size_t index, size_t value);
+/**
+ * @brief Prune the domains of the CSP problem with its unary constraints.
+ *
+ * The values that do not satisfy the constraints whose variables are all the
+ * same are removed from the domains, whose representation is chosen again.
+ * @param csp The CSP problem to prune.
+ * @param data The data to pass to the check function.
+ * @return true if the domains are pruned, false if an error occurred.
+ * @pre The csp library is initialised.
+ * @pre All the constraints of the CSP problem are set.
+ */
+extern bool csp_problem_prune(CSPProblem *csp, const void *data);
+/**
+ * @brief Set the number of threads used to solve the CSP problem.
+ *
+ * The problems are solved in the calling thread by default. With more threads,
+ * the independent components are solved in parallel, so the check functions
+ * must then be safe to call concurrently with the same data.
+ * @param csp The CSP problem to set the number of threads.
+ * @param num_threads The number of threads (0 for the number of online
+ * processors, 1 to solve in the calling thread).
+ * @pre The csp library is initialised.
+ */
+extern void csp_problem_set_num_threads(CSPProblem *csp, size_t num_threads);
+/**
+ * @brief Get the number of threads used to solve the CSP problem.
+ * @param csp The CSP problem to get the number of threads.
+ * @return The number of threads (0 for the number of online processors).
+ * @pre The csp library is initialised.
+ */
+extern size_t csp_problem_get_num_threads(const CSPProblem *csp);
+/**
+ * @brief Set the profiling of the CSP problem.
+ *
+ * A profiled problem records, for each constraint, the number of checks, the
+ * number of failed checks and the time of one check out of sampling, and, for
+ * each depth of the search, the number of values tried.
+ * @param csp The CSP problem to profile.
+ * @param sampling One check out of sampling is timed (0 to disable the
+ * profiling).
+ * @return true if the profiling is set, false if an error occurred.
+ * @pre The csp library is initialised.
+ * @post The profile of the CSP problem is cleared.
+ */
+extern bool csp_problem_set_profiling(CSPProblem *csp, size_t sampling);
+/**
+ * @brief Count the nodes of the search of the CSP problem without profiling
+ * its checks.
+ *
+ * The nodes are counted at each depth as by a profiled problem, but the
+ * checks are neither counted nor timed, so that the search is only slowed
+ * down by one increment per value tried. The counting is disabled by
+ * csp_problem_set_profiling with a sampling of 0.
+ * @param csp The CSP problem to count the nodes.
+ * @return true if the nodes are counted, false if an error occurred.
+ * @pre The csp library is initialised.
+ * @post The profile of the CSP problem is replaced by cleared node counts.
+ */
+extern bool csp_problem_count_nodes(CSPProblem *csp);
+/**
+ * @brief Get the profiling sampling of the CSP problem.
+ * @param csp The CSP problem to get the profiling sampling.
+ * @return One check out of the returned value is timed (0 if the checks are
+ * not profiled).
+ * @pre The csp library is initialised.
+ */
+extern size_t csp_problem_get_profiling(const CSPProblem *csp);
+/**
+ * @brief Get the number of checks of the constraint at the specified index.
+ * @param csp The profiled CSP problem.
+ * @param index The index of the constraint.
+ * @return The number of checks of the constraint.
+ * @pre The csp library is initialised.
+ * @pre The checks of the CSP problem are profiled.
+ * @pre index < csp->num_constraints
+ */
+extern size_t csp_problem_get_profile_checks(const CSPProblem *csp, size_t index);
+/**
+ * @brief Get the number of failed checks of the constraint at the specified
+ * index.
+ * @param csp The profiled CSP problem.
+ * @param index The index of the constraint.
+ * @return The number of failed checks of the constraint.
+ * @pre The csp library is initialised.
+ * @pre The checks of the CSP problem are profiled.
+ * @pre index < csp->num_constraints
+ */
+extern size_t csp_problem_get_profile_failures(const CSPProblem *csp, size_t index);
+/**
+ * @brief Get the estimated time spent checking the constraint at the
+ * specified index.
+ * @param csp The profiled CSP problem.
+ * @param index The index of the constraint.
+ * @return The time of the timed checks extrapolated to all the checks, in
+ * seconds.
+ * @pre The csp library is initialised.
+ * @pre The checks of the CSP problem are profiled.
+ * @pre index < csp->num_constraints
+ */
+extern double csp_problem_get_profile_time(const CSPProblem *csp, size_t index);
+/**
+ * @brief Get the number of nodes explored at the specified depth.
+ *
+ * csp_problem_solve orders the variables by connected component (largest
+ * first): the depth of its nodes counts the variables of the previous
+ * components as assigned, as if the components were solved one after the
+ * other.
+ * @param csp The profiled CSP problem.
+ * @param depth The depth (the number of variables assigned before the node).
+ * @return The number of values tried at the depth.
+ * @pre The csp library is initialised.
+ * @pre The CSP problem is profiled or counts its nodes.
+ * @pre depth < csp->num_domains
+ */
+extern size_t csp_problem_get_profile_nodes(const CSPProblem *csp, size_t depth);
+/**
+ * @brief Write the profile report of the CSP problem.
+ *
+ * The constraints are sorted by decreasing estimated time, then by decreasing
+ * number of checks, and followed by the node histogram.
+ * @param csp The profiled CSP problem.
+ * @param stream The stream to write the report.
+ * @return true if the report is written, false if an error occurred.
+ * @pre The csp library is initialised.
+ * @pre The checks of the CSP problem are profiled.
+ */
+extern bool csp_problem_write_profile(const CSPProblem *csp, FILE *stream);
+/**
+ * @brief Write the profile of the CSP problem in the folded stack format of
+ * flame graphs.
+ *
+ * Each line is a stack "csp;variable V;constraint C" followed by the
+ * estimated time in nanoseconds, where V is the last variable of the
+ * constraint C.
+ * @param csp The profiled CSP problem.
+ * @param stream The stream to write the profile.
+ * @return true if the profile is written, false if an error occurred.
+ * @pre The csp library is initialised.
+ * @pre The checks of the CSP problem are profiled.
+ */
+extern bool csp_problem_write_profile_folded(const CSPProblem *csp, FILE *stream);
 /**
  * @brief Verify if the CSP problem is consistent at the specified index.
  * @param csp The CSP problem to verify.
@@ -202,13 +526,165 @@ extern bool csp_problem_is_consistent(const CSPProblem *csp, const size_t *value
 extern bool csp_problem_backtrack(const CSPProblem *csp, size_t *values, const void *data, size_t index);
 /**
  * @brief Solve the CSP problem using backtracking.
+ *
+ * The connected components of the constraint graph are solved independently
+ * and their solutions are stitched into the values. When the problem has
+ * several components and more than one thread is allowed, the components are
+ * solved in parallel: the check functions must then be thread-safe.
  * @param csp The CSP problem to solve.
  * @param values The values of the variables.
  * @param data The data to pass to the check function.
  * @return true if the CSP problem is solved, false otherwise.
  * @pre The csp library is initialised.
+ * @pre All the constraints of the CSP problem are set.
  * @post The values are assigned to the solution.
  */
 extern bool csp_problem_solve(const CSPProblem *csp, size_t *values, const void *data);
+/**
+ * @brief Minimise the cost of the solution of the CSP problem using
+ * branch-and-bound.
+ *
+ * The subtrees whose lower bound cannot beat the best solution found so far
+ * are pruned. When the time limit is reached, the best solution found so far
+ * is returned.
+ * @param csp The CSP problem to optimise.
+ * @param values The values of the variables.
+ * @param data The data to pass to the check, objective and report functions.
+ * @param objective The objective function.
+ * @param report The function called on each improving solution (or NULL).
+ * @param time_limit The time limit in seconds (0 for no limit).
+ * @param cost The cost of the best solution (or NULL).
+ * @param optimal Set to true if the search has been completed, the cost being
+ * then the optimum or the problem having no solution, and to false if it has
+ * been stopped by the time limit, the report function or an error (or NULL).
+ * @return true if a solution is found, false otherwise.
+ * @pre The csp library is initialised.
+ * @pre objective != NULL
+ * @pre All the constraints of the CSP problem are set.
+ * @post The values are assigned to the best solution found.
+ */
+extern bool csp_problem_minimise(const CSPProblem *csp, size_t *values, const void *data, CSPObjective *objective, CSPReporter *report, double time_limit, double *cost, bool *optimal);
+/**
+ * @brief Minimise a weighted sum of the values of the CSP problem using
+ * branch-and-bound.
+ * @param csp The CSP problem to optimise.
+ * @param values The values of the variables.
+ * @param data The data to pass to the check and report functions.
+ * @param weights The weights of the variables.
+ * @param report The function called on each improving solution (or NULL).
+ * @param time_limit The time limit in seconds (0 for no limit).
+ * @param cost The cost of the best solution (or NULL).
+ * @param optimal Set to true if the search has been completed, the cost being
+ * then the optimum or the problem having no solution, and to false if it has
+ * been stopped by the time limit, the report function or an error (or NULL).
+ * @return true if a solution is found, false otherwise.
+ * @pre The csp library is initialised.
+ * @pre weights != NULL
+ * @pre All the constraints of the CSP problem are set.
+ * @post The values are assigned to the best solution found.
+ */
+extern bool csp_problem_minimise_linear(const CSPProblem *csp, size_t *values, const void *data, const double *weights, CSPReporter *report, double time_limit, double *cost, bool *optimal);
+/**
+ * @brief Begin a resumable search of the solutions of the CSP problem.
+ *
+ * The solutions are yielded one at a time by csp_search_next, in the order of
+ * csp_problem_backtrack, without restarting the search between calls.
+ * @param csp The CSP problem to solve.
+ * @param data The data to pass to the check function.
+ * @return The search created or NULL if an error occurred.
+ * @pre The csp library is initialised.
+ * @pre All the constraints of the CSP problem are set.
+ * @post The CSP problem must not be modified nor destroyed before the end of
+ * the search.
+ */
+extern CSPSearch *csp_search_begin(const CSPProblem *csp, const void *data);
+/**
+ * @brief Find the next solution of the search.
+ * @param search The search to resume.
+ * @param values The values of the variables.
+ * @return true if a solution is found, false if there are no more solutions.
+ * @pre The csp library is initialised.
+ * @pre search != NULL
+ * @post The values are assigned to the solution.
+ */
+extern bool csp_search_next(CSPSearch *search, size_t *values);
+/**
+ * @brief End the search.
+ * @param search The search to end.
+ * @pre The csp library is initialised.
+ * @pre search != NULL
+ * @post The search is freed.
+ */
+extern void csp_search_end(CSPSearch *search);
+/**
+ * @brief Split the CSP problem into cubes written to a work file.
+ *
+ * The cubes are the consistent assignments of the first variables, the number
+ * of variables being the smallest one giving at least the requested number of
+ * cubes. A cube is kept only if the next variable still has a consistent
+ * value (lookahead). The work file also records the next cube to solve, the
+ * number of completed cubes and the first solution found by the workers.
+ * @param csp The CSP problem to split.
+ * @param data The data to pass to the check function.
+ * @param num_cubes The minimum number of cubes.
+ * @param path The path of the work file.
+ * @param count The number of cubes written (or NULL).
+ * @return true if the work file is written, false if an error occurred.
+ * @pre The csp library is initialised.
+ * @pre All the constraints of the CSP problem are set.
+ */
+extern bool csp_cube_split(const CSPProblem *csp, const void *data, size_t num_cubes, const char *path, size_t *count);
+/**
+ * @brief Solve the cubes of a work file until a solution is found.
+ *
+ * The cubes are claimed one at a time, so that several workers (threads
+ * excepted) can share the same work file. A cube is completed when its
+ * search is finished without solution. The worker stops when all the cubes
+ * are claimed, when another worker has found a solution or when an error
+ * occurs, leaving its claimed cube uncompleted.
+ * @param csp The CSP problem that has been split.
+ * @param values The values of the variables.
+ * @param data The data to pass to the check function.
+ * @param path The path of the work file.
+ * @return CSP_CUBE_SOLVED if a solution is recorded in the work file (by this
+ * worker or another one), CSP_CUBE_UNSATISFIABLE if all the cubes have been
+ * completed, CSP_CUBE_INCOMPLETE otherwise.
+ * @pre The csp library is initialised.
+ * @post The values are assigned to the solution, which is also recorded in
+ * the work file if no other solution has been recorded.
+ */
+extern CSPCubeResult csp_cube_work(const CSPProblem *csp, size_t *values, const void *data, const char *path);
+/**
+ * @brief Read the solution recorded in a work file.
+ * @param path The path of the work file.
+ * @param values The values of the variables.
+ * @return true if a solution is recorded, false otherwise.
+ * @pre The csp library is initialised.
+ * @post The values are assigned to the solution.
+ */
+extern bool csp_cube_solution(const char *path, size_t *values);
+/**
+ * @brief Solve the CSP problem with cube-and-conquer using worker processes.
+ *
+ * The problem is split into cubes written to the work file, the cubes are
+ * solved by forked worker processes and all the workers are stopped as soon
+ * as one of them has found a solution. The problem is only reported
+ * unsatisfiable if all the cubes have been completed.
+ * @param csp The CSP problem to solve.
+ * @param values The values of the variables.
+ * @param data The data to pass to the check function.
+ * @param path The path of the work file.
+ * @param num_cubes The minimum number of cubes.
+ * @param num_workers The number of worker processes.
+ * @return CSP_CUBE_SOLVED if the CSP problem is solved,
+ * CSP_CUBE_UNSATISFIABLE if it has no solution, CSP_CUBE_INCOMPLETE if an
+ * error occurred (the work file cannot be written, or a worker has failed
+ * before completing its cubes).
+ * @pre The csp library is initialised.
+ * @pre num_workers > 0
+ * @pre All the constraints of the CSP problem are set.
+ * @post The values are assigned to the solution.
+ */
+extern CSPCubeResult csp_cube_solve(const CSPProblem *csp, size_t *values, const void *data, const char *path, size_t num_cubes, size_t num_workers);
 
 #endif  // CSP_H_
@@ -0,0 +1,64 @@
+/**
+ * @file problems.h
+ * @brief Check functions and problems shared by the tests.
+ */
+
+#ifndef PROBLEMS_H
+#define PROBLEMS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "csp.h"
+
+// Check if the queens are compatible
+static inline bool queen_compatibles(const CSPConstraint *constraint,
+                                     const size_t *values, const void *data) {
+  (void)data;
+  size_t x0 = csp_constraint_get_variable(constraint, 0);
+  size_t x1 = csp_constraint_get_variable(constraint, 1);
+  size_t y0 = values[x0];
+  size_t y1 = values[x1];
+  return y0 != y1 && x0 + y1 != x1 + y0 && x0 + y0 != x1 + y1;
+}
+
+// Check if the values are different
+static inline bool different(const CSPConstraint *constraint,
+                             const size_t *values, const void *data) {
+  (void)data;
+  size_t v0 = csp_constraint_get_variable(constraint, 0);
+  size_t v1 = csp_constraint_get_variable(constraint, 1);
+  return values[v0] != values[v1];
+}
+
+// Create a problem with all the pairs of variables constrained
+static inline CSPProblem *create_pairs(size_t n, size_t domain,
+                                       CSPChecker *check) {
+  CSPProblem *problem = csp_problem_create(n, n * (n - 1) / 2);
+  size_t index = 0;
+  for (size_t i = 0; i < n; i++) {
+    csp_problem_set_domain(problem, i, domain);
+    for (size_t j = i + 1; j < n; j++) {
+      CSPConstraint *constraint = csp_constraint_create(2, check);
+      csp_constraint_set_variable(constraint, 0, i);
+      csp_constraint_set_variable(constraint, 1, j);
+      csp_problem_set_constraint(problem, index++, constraint);
+    }
+  }
+  return problem;
+}
+
+// Create the n-queens problem
+static inline CSPProblem *create_queens(size_t n) {
+  return create_pairs(n, n, queen_compatibles);
+}
+
+// Destroy a problem and its constraints
+static inline void destroy(CSPProblem *problem) {
+  for (size_t i = 0; i < csp_problem_get_num_constraints(problem); i++) {
+    csp_constraint_destroy(csp_problem_get_constraint(problem, i));
+  }
+  csp_problem_destroy(problem);
+}
+
+#endif
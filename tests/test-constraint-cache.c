@@ -0,0 +1,103 @@
+#include <stdlib.h>
+
+#include "csp.h"
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#include <assert.h>
+
+#include "problems.h"
+
+// Number of invocations of the check function
+static size_t checks = 0;
+
+// Check if the queens are compatible, counting the invocations
+bool counted_queens(const CSPConstraint *constraint, const size_t *values,
+                    const void *data) {
+  checks++;
+  return queen_compatibles(constraint, values, data);
+}
+
+// Solve the 8-queens problem with the specified cache capacity
+static size_t solve(size_t capacity, size_t *queens, size_t *hits,
+                    size_t *misses) {
+  CSPProblem *problem = create_pairs(8, 8, counted_queens);
+  assert(problem != NULL);
+  for (size_t i = 0; i < 28; i++) {
+    CSPConstraint *constraint = csp_problem_get_constraint(problem, i);
+    assert(csp_constraint_set_cache(constraint, capacity));
+    assert(csp_constraint_get_cache(constraint) == capacity);
+  }
+  checks = 0;
+  assert(csp_problem_solve(problem, queens, NULL));
+  *hits = 0;
+  *misses = 0;
+  for (size_t i = 0; i < 28; i++) {
+    CSPConstraint *constraint = csp_problem_get_constraint(problem, i);
+    *hits += csp_constraint_get_cache_hits(constraint);
+    *misses += csp_constraint_get_cache_misses(constraint);
+    csp_constraint_clear_cache(constraint);
+    assert(csp_constraint_get_cache_hits(constraint) == 0);
+    assert(csp_constraint_get_cache_misses(constraint) == 0);
+  }
+  destroy(problem);
+  return checks;
+}
+
+int main(void) {
+  // Initialise the library
+  csp_init();
+  {
+    size_t reference[8], direct[8], hashed[8];
+    size_t hits, misses;
+    // Solve without cache
+    size_t uncached = solve(0, reference, &hits, &misses);
+    assert(hits == 0 && misses == 0);
+    // Solve with a direct-mapped cache (8 x 8 tuples)
+    size_t cached = solve(64, direct, &hits, &misses);
+    assert(cached == misses);
+    assert(hits + misses == uncached);
+    assert(hits > 0);
+    assert(cached < uncached);
+    // Solve with a hashed cache
+    cached = solve(16, hashed, &hits, &misses);
+    assert(cached == misses);
+    assert(hits + misses == uncached);
+    // The solutions are the same
+    for (size_t i = 0; i < 8; i++) {
+      assert(direct[i] == reference[i]);
+      assert(hashed[i] == reference[i]);
+    }
+  }
+  {
+    // Changing the variables of a constraint invalidates its cache
+    size_t values[] = {0, 1, 2};
+    CSPProblem *problem = csp_problem_create(3, 1);
+    CSPConstraint *constraint = csp_constraint_create(2, queen_compatibles);
+    assert(csp_constraint_set_cache(constraint, 9));
+    csp_constraint_set_variable(constraint, 0, 0);
+    csp_constraint_set_variable(constraint, 1, 1);
+    csp_problem_set_constraint(problem, 0, constraint);
+    for (size_t i = 0; i < 3; i++) {
+      csp_problem_set_domain(problem, i, 3);
+    }
+    assert(!csp_problem_is_consistent(problem, values, NULL, 3));
+    assert(!csp_problem_is_consistent(problem, values, NULL, 3));
+    assert(csp_constraint_get_cache_hits(constraint) == 1);
+    csp_constraint_set_variable(constraint, 1, 2);
+    assert(!csp_problem_is_consistent(problem, values, NULL, 3));
+    assert(csp_constraint_get_cache_misses(constraint) == 2);
+    values[0] = 1;
+    assert(csp_problem_is_consistent(problem, values, NULL, 3));
+    // Disable the cache
+    assert(csp_constraint_set_cache(constraint, 0));
+    assert(csp_constraint_get_cache(constraint) == 0);
+    assert(csp_constraint_get_cache_misses(constraint) == 0);
+    csp_constraint_destroy(constraint);
+    csp_problem_destroy(problem);
+  }
+  // Finish the library
+  csp_finish();
+
+  return EXIT_SUCCESS;
+}
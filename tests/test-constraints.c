@@ -0,0 +1,72 @@
+#include <stdlib.h>
+
+#include "csp.h"
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#include <assert.h>
+
+// Check if the values are different
+bool different(const CSPConstraint *constraint, const size_t *values,
+               const void *data) {
+  (void)data;
+  return values[csp_constraint_get_variable(constraint, 0)] !=
+         values[csp_constraint_get_variable(constraint, 1)];
+}
+
+int main(void) {
+  // Initialise the library
+  csp_init();
+  {
+    // Create an array of constraints for the edges of a triangle
+    CSPConstraint *constraints = csp_constraints_create(3, 2, different);
+    assert(constraints != NULL);
+    assert(csp_constraints_get(constraints, 0) == constraints);
+    for (size_t i = 0; i < 3; i++) {
+      CSPConstraint *constraint = csp_constraints_get(constraints, i);
+      // Check that the constraint is created correctly
+      assert(csp_constraint_get_arity(constraint) == 2);
+      assert(csp_constraint_get_check(constraint) == different);
+      assert(csp_constraint_get_variable(constraint, 0) == 0);
+      assert(csp_constraint_get_variable(constraint, 1) == 0);
+      csp_constraint_set_variable(constraint, 0, i);
+      csp_constraint_set_variable(constraint, 1, (i + 1) % 3);
+    }
+    // The constraints do not overlap
+    for (size_t i = 0; i < 3; i++) {
+      CSPConstraint *constraint = csp_constraints_get(constraints, i);
+      assert(csp_constraint_get_variable(constraint, 0) == i);
+      assert(csp_constraint_get_variable(constraint, 1) == (i + 1) % 3);
+    }
+
+    // Colour the triangle
+    CSPProblem *problem = csp_problem_create(3, 3);
+    for (size_t i = 0; i < 3; i++) {
+      csp_problem_set_constraint(problem, i, csp_constraints_get(constraints, i));
+      csp_problem_set_domain(problem, i, 2);
+    }
+    size_t values[3];
+    // Two colours are not enough
+    assert(!csp_problem_solve(problem, values, NULL));
+    for (size_t i = 0; i < 3; i++) {
+      csp_problem_set_domain(problem, i, 3);
+    }
+    // Three colours are enough
+    assert(csp_problem_solve(problem, values, NULL));
+    assert(csp_problem_is_consistent(problem, values, NULL, 3));
+    assert(values[0] != values[1] && values[1] != values[2] &&
+           values[0] != values[2]);
+
+    // Cached constraints are released with the array
+    csp_constraint_set_cache(csp_constraints_get(constraints, 1), 16);
+    assert(csp_problem_solve(problem, values, NULL));
+
+    // Destroy the problem and the constraints
+    csp_problem_destroy(problem);
+    csp_constraints_destroy(constraints, 3);
+  }
+  // Finish the library
+  csp_finish();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "csp.h"
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#include <assert.h>
+
+#include "problems.h"
+
+// Claim the first cube of a work file as a worker failing before
+// completing it
+static void lose_first_cube(const char *path) {
+  FILE *stream = fopen(path, "r+");
+  assert(stream != NULL);
+  char line[256];
+  long offset = 0;
+  while (fgets(line, sizeof(line), stream) != NULL &&
+         strncmp(line, "next", 4)) {
+    offset = ftell(stream);
+  }
+  assert(!strncmp(line, "next", 4));
+  assert(!fseek(stream, offset + 4, SEEK_SET));
+  assert(fprintf(stream, "%21zu", (size_t)1) == 21);
+  assert(!fclose(stream));
+}
+
+int main(void) {
+  // A unique work file, so that concurrent runs do not share it
+  char path[] = "test-cube-XXXXXX";
+  int fd = mkstemp(path);
+  assert(fd >= 0);
+  close(fd);
+  // Initialise the library
+  csp_init();
+  {
+    // Split the 10-queens problem and solve the cubes in this process
+    CSPProblem *problem = create_queens(10);
+    size_t values[10], recorded[10];
+    size_t count;
+    assert(csp_cube_split(problem, NULL, 64, path, &count));
+    assert(count >= 64);
+    assert(!csp_cube_solution(path, recorded));
+    assert(csp_cube_work(problem, values, NULL, path) == CSP_CUBE_SOLVED);
+    assert(csp_problem_is_consistent(problem, values, NULL, 10));
+    // The solution is recorded in the work file and stops the other workers
+    assert(csp_cube_solution(path, recorded));
+    for (size_t i = 0; i < 10; i++) {
+      assert(recorded[i] == values[i]);
+    }
+    assert(csp_cube_work(problem, values, NULL, path) == CSP_CUBE_SOLVED);
+    // The cubes are solved in the order of the plain search
+    size_t expected[10];
+    assert(csp_problem_backtrack(problem, expected, NULL, 0));
+    for (size_t i = 0; i < 10; i++) {
+      assert(recorded[i] == expected[i]);
+    }
+    destroy(problem);
+  }
+  {
+    // Solve the 14-queens problem with several worker processes
+    CSPProblem *problem = create_queens(14);
+    size_t values[14];
+    assert(csp_cube_solve(problem, values, NULL, path, 200, 4) ==
+           CSP_CUBE_SOLVED);
+    assert(csp_problem_is_consistent(problem, values, NULL, 14));
+    destroy(problem);
+  }
+  {
+    // The cubes of the 4-queens problem are its solutions
+    CSPProblem *problem = create_queens(4);
+    size_t values[4];
+    size_t count;
+    assert(csp_cube_split(problem, NULL, 1000, path, &count));
+    assert(count == 2);
+    assert(csp_cube_solve(problem, values, NULL, path, 1000, 3) ==
+           CSP_CUBE_SOLVED);
+    assert(csp_problem_is_consistent(problem, values, NULL, 4));
+    destroy(problem);
+  }
+  {
+    // The 3-queens problem is refuted by the split
+    CSPProblem *problem = create_queens(3);
+    size_t values[3];
+    size_t count;
+    assert(csp_cube_split(problem, NULL, 4, path, &count));
+    assert(count == 0);
+    assert(csp_cube_solve(problem, values, NULL, path, 4, 2) ==
+           CSP_CUBE_UNSATISFIABLE);
+    destroy(problem);
+  }
+  {
+    // Seven pigeons in six holes are refuted by the workers
+    CSPProblem *problem = create_pairs(7, 6, different);
+    size_t values[7];
+    size_t count;
+    assert(csp_cube_split(problem, NULL, 20, path, &count));
+    assert(count >= 20);
+    assert(csp_cube_solve(problem, values, NULL, path, 20, 3) ==
+           CSP_CUBE_UNSATISFIABLE);
+    assert(!csp_cube_solution(path, values));
+    // A cube lost by a failing worker is not mistaken for a refuted one
+    assert(csp_cube_split(problem, NULL, 20, path, &count));
+    lose_first_cube(path);
+    assert(csp_cube_work(problem, values, NULL, path) == CSP_CUBE_INCOMPLETE);
+    assert(!csp_cube_solution(path, values));
+    // A work file that cannot be read is not refuted either
+    assert(csp_cube_work(problem, values, NULL, "missing.work") ==
+           CSP_CUBE_INCOMPLETE);
+    destroy(problem);
+  }
+  remove(path);
+  // Finish the library
+  csp_finish();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,140 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "csp.h"
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#include <assert.h>
+
+#include "problems.h"
+
+// Check if the value is even
+bool even(const CSPConstraint *constraint, const size_t *values,
+          const void *data) {
+  (void)data;
+  return values[csp_constraint_get_variable(constraint, 0)] % 2 == 0;
+}
+
+int main(void) {
+  // Initialise the library
+  csp_init();
+  {
+    CSPProblem *problem = create_pairs(4, 0, different);
+    size_t values[100];
+    // An interval with an offset
+    csp_problem_set_domain_interval(problem, 0, 100, 103);
+    assert(csp_problem_get_domain(problem, 0) == 4);
+    assert(csp_problem_get_domain_values(problem, 0, values) == 4);
+    for (size_t i = 0; i < 4; i++) {
+      assert(values[i] == 100 + i);
+    }
+    assert(!csp_problem_in_domain(problem, 0, 99));
+    assert(csp_problem_in_domain(problem, 0, 103));
+    assert(!csp_problem_in_domain(problem, 0, 104));
+    assert(csp_problem_get_domain_memory(problem, 0) == 0);
+    // A sparse list, in any order and with duplicates
+    size_t sparse[] = {1000000, 5, 1000000000000, 5, 42};
+    assert(csp_problem_set_domain_values(problem, 1, sparse, 5));
+    assert(csp_problem_get_domain(problem, 1) == 4);
+    assert(csp_problem_get_domain_values(problem, 1, values) == 4);
+    assert(values[0] == 5 && values[1] == 42 && values[2] == 1000000 &&
+           values[3] == 1000000000000);
+    assert(csp_problem_in_domain(problem, 1, 42));
+    assert(!csp_problem_in_domain(problem, 1, 43));
+    assert(csp_problem_get_domain_memory(problem, 1) == 4 * sizeof(size_t));
+    // A dense set of values
+    size_t dense[50];
+    for (size_t i = 0; i < 50; i++) {
+      dense[i] = 1000 + 3 * (49 - i);
+    }
+    assert(csp_problem_set_domain_values(problem, 2, dense, 50));
+    assert(csp_problem_get_domain_values(problem, 2, values) == 50);
+    for (size_t i = 0; i < 50; i++) {
+      assert(values[i] == 1000 + 3 * i);
+      assert(csp_problem_in_domain(problem, 2, values[i]));
+      assert(!csp_problem_in_domain(problem, 2, values[i] + 1));
+    }
+    // The span of 147 values takes three words
+    assert(csp_problem_get_domain_memory(problem, 2) == 3 * sizeof(uint64_t));
+    // Contiguous values are an interval
+    size_t contiguous[] = {7, 5, 6};
+    assert(csp_problem_set_domain_values(problem, 3, contiguous, 3));
+    assert(csp_problem_get_domain_values(problem, 3, values) == 3);
+    assert(values[0] == 5 && values[2] == 7);
+    assert(csp_problem_get_domain_memory(problem, 3) == 0);
+    // An empty domain
+    assert(csp_problem_set_domain_values(problem, 3, NULL, 0));
+    assert(csp_problem_get_domain(problem, 3) == 0);
+    size_t solution[4];
+    assert(!csp_problem_solve(problem, solution, NULL));
+    destroy(problem);
+  }
+  {
+    // Solve with sparse domains where only few values are compatible
+    CSPProblem *problem = create_pairs(3, 0, different);
+    size_t d0[] = {7, 1000000007};
+    size_t d1[] = {7, 99};
+    size_t d2[] = {99, 1000000007, 7};
+    assert(csp_problem_set_domain_values(problem, 0, d0, 2));
+    assert(csp_problem_set_domain_values(problem, 1, d1, 2));
+    assert(csp_problem_set_domain_values(problem, 2, d2, 3));
+    size_t values[3];
+    assert(csp_problem_solve(problem, values, NULL));
+    assert(values[0] == 7 && values[1] == 99 && values[2] == 1000000007);
+    // Enumerate the solutions with the cursor
+    CSPSearch *search = csp_search_begin(problem, NULL);
+    size_t count = 0;
+    while (csp_search_next(search, values)) {
+      for (size_t i = 0; i < 3; i++) {
+        assert(csp_problem_in_domain(problem, i, values[i]));
+      }
+      assert(csp_problem_is_consistent(problem, values, NULL, 3));
+      count++;
+    }
+    csp_search_end(search);
+    assert(count == 3);
+    // The cached checks index the domains from their smallest value
+    for (size_t i = 0; i < 3; i++) {
+      assert(csp_constraint_set_cache(csp_problem_get_constraint(problem, i),
+                                      1 << 20));
+    }
+    assert(csp_problem_backtrack(problem, values, NULL, 0));
+    assert(values[0] == 7 && values[1] == 99 && values[2] == 1000000007);
+    destroy(problem);
+  }
+  {
+    // Prune the odd values with a unary constraint
+    CSPProblem *problem = csp_problem_create(2, 2);
+    CSPConstraint *constraint = csp_constraint_create(1, even);
+    csp_constraint_set_variable(constraint, 0, 1);
+    csp_problem_set_constraint(problem, 0, constraint);
+    constraint = csp_constraint_create(2, different);
+    csp_constraint_set_variable(constraint, 0, 0);
+    csp_constraint_set_variable(constraint, 1, 1);
+    csp_problem_set_constraint(problem, 1, constraint);
+    csp_problem_set_domain_interval(problem, 0, 10, 11);
+    csp_problem_set_domain_interval(problem, 1, 9, 109);
+    assert(csp_problem_prune(problem, NULL));
+    assert(csp_problem_get_domain(problem, 0) == 2);
+    assert(csp_problem_get_domain(problem, 1) == 50);
+    assert(csp_problem_in_domain(problem, 1, 10));
+    assert(!csp_problem_in_domain(problem, 1, 11));
+    assert(!csp_problem_in_domain(problem, 1, 9));
+    assert(!csp_problem_in_domain(problem, 1, 109));
+    size_t values[2];
+    assert(csp_problem_solve(problem, values, NULL));
+    assert(values[0] == 10 && values[1] == 12);
+    // Minimise with a negative weight reaches the largest value
+    double weights[] = {1, -1};
+    double cost;
+    assert(csp_problem_minimise_linear(problem, values, NULL, weights, NULL, 0,
+                                       &cost, NULL));
+    assert(values[0] == 10 && values[1] == 108 && cost == -98);
+    destroy(problem);
+  }
+  // Finish the library
+  csp_finish();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,164 @@
+#include <stdlib.h>
+
+#include "csp.h"
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#include <assert.h>
+
+#include "problems.h"
+
+// Cost of the queens: sum of the rows weighted by the columns, the
+// unassigned queens cost at least 0
+double queens_cost(const CSPProblem *csp, const size_t *values,
+                   const void *data, size_t index) {
+  (void)csp;
+  (void)data;
+  double cost = 0;
+  for (size_t i = 0; i < index; i++) {
+    cost += (double)((i + 1) * values[i]);
+  }
+  return cost;
+}
+
+// Cost of the queens without a bound on the partial assignments, so that
+// nothing is pruned
+double unbounded_cost(const CSPProblem *csp, const size_t *values,
+                      const void *data, size_t index) {
+  return index < csp_problem_get_num_domains(csp)
+             ? 0
+             : queens_cost(csp, values, data, index);
+}
+
+// Number and last cost of the reported solutions
+static size_t reports = 0;
+static double last = 0;
+
+// Verify that the reported solutions are improving
+bool improving(const CSPProblem *csp, const size_t *values, double cost,
+               const void *data) {
+  (void)data;
+  assert(csp_problem_is_consistent(csp, values, NULL,
+                                   csp_problem_get_num_domains(csp)));
+  assert(reports == 0 || cost < last);
+  last = cost;
+  reports++;
+  return true;
+}
+
+// Stop at the first solution
+bool first(const CSPProblem *csp, const size_t *values, double cost,
+           const void *data) {
+  (void)csp;
+  (void)values;
+  (void)cost;
+  (void)data;
+  reports++;
+  return false;
+}
+
+int main(void) {
+  // Initialise the library
+  csp_init();
+  {
+    // Three different values in 0..4 with a negative weight
+    CSPProblem *problem = create_pairs(3, 5, different);
+    double weights[] = {3, -1, 2};
+    size_t values[3];
+    double cost;
+    bool optimal = false;
+    reports = 0;
+    assert(csp_problem_minimise_linear(problem, values, NULL, weights,
+                                       improving, 0, &cost, &optimal));
+    assert(optimal);
+    assert(cost == -2);
+    assert(values[0] == 0 && values[1] == 4 && values[2] == 1);
+    assert(reports > 0 && last == cost);
+    destroy(problem);
+  }
+  {
+    // Minimise the weighted rows of the 6-queens and compare with the
+    // enumeration of all the assignments
+    CSPProblem *problem = create_queens(6);
+    size_t values[6];
+    double cost;
+    bool optimal = false;
+    reports = 0;
+    assert(csp_problem_minimise(problem, values, NULL, queens_cost, improving,
+                                0, &cost, &optimal));
+    assert(optimal);
+    assert(cost == queens_cost(problem, values, NULL, 6));
+    double best = -1;
+    size_t assignment[6] = {0};
+    for (size_t k = 0; k < 6 * 6 * 6 * 6 * 6 * 6; k++) {
+      for (size_t i = 0, r = k; i < 6; i++, r /= 6) {
+        assignment[i] = r % 6;
+      }
+      if (csp_problem_is_consistent(problem, assignment, NULL, 6)) {
+        double value = queens_cost(problem, assignment, NULL, 6);
+        if (best < 0 || value < best) {
+          best = value;
+        }
+      }
+    }
+    assert(cost == best);
+    // The report function can stop the search
+    reports = 0;
+    assert(csp_problem_minimise(problem, values, NULL, queens_cost, first, 0,
+                                NULL, &optimal));
+    assert(!optimal);
+    assert(reports == 1);
+    assert(csp_problem_is_consistent(problem, values, NULL, 6));
+    destroy(problem);
+  }
+  {
+    // The best solution found is returned when the time limit is reached: the
+    // first solution is found within the first 1024 values tried (before the
+    // first check of the deadline) and the search cannot be completed in 1 ms
+    CSPProblem *problem = create_queens(12);
+    size_t values[12];
+    double cost;
+    bool optimal = true;
+    reports = 0;
+    assert(csp_problem_minimise(problem, values, NULL, unbounded_cost,
+                                improving, 0.001, &cost, &optimal));
+    assert(!optimal);
+    assert(reports > 0);
+    assert(csp_problem_is_consistent(problem, values, NULL, 12));
+    assert(cost == last);
+    destroy(problem);
+  }
+  {
+    // The deadline is checked while a wide domain is scanned: the first
+    // solution is found at once and the 2e8 values of the last variable
+    // cannot all be tried in 1 ms
+    CSPProblem *problem = create_pairs(2, 4, different);
+    csp_problem_set_domain(problem, 1, 200000000);
+    double weights[] = {1, 1};
+    size_t values[2];
+    double cost;
+    bool optimal = true;
+    reports = 0;
+    assert(csp_problem_minimise_linear(problem, values, NULL, weights,
+                                       improving, 0.001, &cost, &optimal));
+    assert(!optimal);
+    assert(reports == 1);
+    assert(cost == 1 && values[0] == 0 && values[1] == 1);
+    destroy(problem);
+  }
+  {
+    // A problem without solution
+    CSPProblem *problem = create_queens(3);
+    size_t values[3];
+    bool optimal = false;
+    assert(!csp_problem_minimise(problem, values, NULL, queens_cost, NULL, 0,
+                                 NULL, &optimal));
+    // The search has been completed: the problem is infeasible
+    assert(optimal);
+    destroy(problem);
+  }
+  // Finish the library
+  csp_finish();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,146 @@
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "csp.h"
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#include <assert.h>
+
+#include "problems.h"
+
+// Number of invocations and failures of the check function
+static atomic_size_t checks = 0;
+static atomic_size_t failures = 0;
+
+// Check if the queens are compatible, counting the invocations and failures
+bool counted_queens(const CSPConstraint *constraint, const size_t *values,
+                    const void *data) {
+  bool result = queen_compatibles(constraint, values, data);
+  checks++;
+  failures += !result;
+  return result;
+}
+
+int main(void) {
+  // Initialise the library
+  csp_init();
+  {
+    // Create the 8-queens problem
+    CSPProblem *problem = create_pairs(8, 8, counted_queens);
+    assert(csp_problem_get_profiling(problem) == 0);
+    assert(csp_problem_set_profiling(problem, 4));
+    assert(csp_problem_get_profiling(problem) == 4);
+    // Solve the problem
+    size_t values[8];
+    assert(csp_problem_solve(problem, values, NULL));
+    // The counters match the invocations of the check function
+    size_t total_checks = 0;
+    size_t total_failures = 0;
+    for (size_t i = 0; i < 28; i++) {
+      total_checks += csp_problem_get_profile_checks(problem, i);
+      total_failures += csp_problem_get_profile_failures(problem, i);
+      assert(csp_problem_get_profile_failures(problem, i) <=
+             csp_problem_get_profile_checks(problem, i));
+      assert(csp_problem_get_profile_time(problem, i) >= 0);
+    }
+    assert(total_checks == checks);
+    assert(total_failures == failures);
+    // The first queen is placed in the first row of the solution
+    assert(csp_problem_get_profile_nodes(problem, 0) == values[0] + 1);
+    for (size_t depth = 1; depth < 8; depth++) {
+      assert(csp_problem_get_profile_nodes(problem, depth) > 0);
+    }
+    // Write the sorted report
+    FILE *stream = tmpfile();
+    assert(csp_problem_write_profile(problem, stream));
+    rewind(stream);
+    char line[256];
+    size_t lines = 0;
+    double previous = -1;
+    assert(fgets(line, sizeof(line), stream) != NULL);
+    while (fgets(line, sizeof(line), stream) != NULL && strcmp(line, "\n")) {
+      size_t constraint, c, f;
+      double time;
+      assert(sscanf(line, "%zu %zu %zu %lf", &constraint, &c, &f, &time) == 4);
+      assert(c == csp_problem_get_profile_checks(problem, constraint));
+      assert(previous < 0 || time <= previous);
+      previous = time;
+      lines++;
+    }
+    assert(lines == 28);
+    fclose(stream);
+    // Write the folded stacks
+    stream = tmpfile();
+    assert(csp_problem_write_profile_folded(problem, stream));
+    rewind(stream);
+    while (fgets(line, sizeof(line), stream) != NULL) {
+      size_t variable, constraint, nanoseconds;
+      assert(sscanf(line, "csp;variable %zu;constraint %zu %zu", &variable,
+                    &constraint, &nanoseconds) == 3);
+      assert(variable ==
+             csp_constraint_get_variable(
+                 csp_problem_get_constraint(problem, constraint), 1));
+      assert(nanoseconds > 0);
+    }
+    fclose(stream);
+    // The plain search is also profiled
+    assert(csp_problem_set_profiling(problem, 1));
+    assert(csp_problem_get_profile_nodes(problem, 0) == 0);
+    checks = 0;
+    assert(csp_problem_backtrack(problem, values, NULL, 0));
+    total_checks = 0;
+    for (size_t i = 0; i < 28; i++) {
+      total_checks += csp_problem_get_profile_checks(problem, i);
+    }
+    assert(total_checks == checks);
+    assert(csp_problem_get_profile_nodes(problem, 0) == values[0] + 1);
+    // Only count the nodes: the same nodes are counted without the checks
+    size_t nodes[8];
+    for (size_t depth = 0; depth < 8; depth++) {
+      nodes[depth] = csp_problem_get_profile_nodes(problem, depth);
+    }
+    assert(csp_problem_count_nodes(problem));
+    assert(csp_problem_get_profiling(problem) == 0);
+    assert(csp_problem_get_profile_nodes(problem, 0) == 0);
+    assert(csp_problem_backtrack(problem, values, NULL, 0));
+    for (size_t depth = 0; depth < 8; depth++) {
+      assert(csp_problem_get_profile_nodes(problem, depth) == nodes[depth]);
+    }
+    // Disable the profiling
+    assert(csp_problem_set_profiling(problem, 0));
+    assert(csp_problem_get_profiling(problem) == 0);
+    destroy(problem);
+  }
+  {
+    // Two independent 5-queens problems solved by two threads
+    CSPProblem *problem = csp_problem_create(10, 20);
+    size_t index = 0;
+    for (size_t i = 0; i < 10; i++) {
+      csp_problem_set_domain(problem, i, 5);
+      for (size_t j = i + 1; j < i - i % 5 + 5; j++) {
+        CSPConstraint *constraint = csp_constraint_create(2, counted_queens);
+        csp_constraint_set_variable(constraint, 0, i);
+        csp_constraint_set_variable(constraint, 1, j);
+        csp_problem_set_constraint(problem, index++, constraint);
+      }
+    }
+    assert(csp_problem_set_profiling(problem, 1));
+    csp_problem_set_num_threads(problem, 2);
+    size_t values[10];
+    assert(csp_problem_solve(problem, values, NULL));
+    // The nodes of the second component are counted after the first one
+    assert(csp_problem_get_profile_nodes(problem, 0) == values[0] + 1);
+    assert(csp_problem_get_profile_nodes(problem, 5) == values[5] + 1);
+    for (size_t depth = 0; depth < 10; depth++) {
+      assert(csp_problem_get_profile_nodes(problem, depth) > 0);
+    }
+    destroy(problem);
+  }
+  // Finish the library
+  csp_finish();
+
+  return EXIT_SUCCESS;
+}
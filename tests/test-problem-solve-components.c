@@ -0,0 +1,102 @@
+#include <stdlib.h>
+
+#include "csp.h"
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#include <assert.h>
+
+#include "problems.h"
+
+// Create a problem made of independent queens problems and free variables
+static CSPProblem *create(size_t num_boards, const size_t *sizes,
+                          size_t num_free) {
+  size_t num_domains = num_free;
+  size_t num_constraints = 0;
+  for (size_t b = 0; b < num_boards; b++) {
+    num_domains += sizes[b];
+    num_constraints += sizes[b] * (sizes[b] - 1) / 2;
+  }
+  CSPProblem *problem = csp_problem_create(num_domains, num_constraints);
+  assert(problem != NULL);
+  // The boards are interleaved with the free variables
+  size_t variable = 0;
+  size_t index = 0;
+  for (size_t b = 0; b < num_boards; b++) {
+    size_t first = variable;
+    for (size_t i = 0; i < sizes[b]; i++) {
+      csp_problem_set_domain(problem, variable++, sizes[b]);
+    }
+    for (size_t i = first; i < variable; i++) {
+      for (size_t j = i + 1; j < variable; j++) {
+        CSPConstraint *constraint = csp_constraint_create(2, queen_compatibles);
+        csp_constraint_set_variable(constraint, 0, i);
+        csp_constraint_set_variable(constraint, 1, j);
+        csp_problem_set_constraint(problem, index++, constraint);
+      }
+    }
+    if (b < num_free) {
+      csp_problem_set_domain(problem, variable++, 3);
+    }
+  }
+  while (variable < num_domains) {
+    csp_problem_set_domain(problem, variable++, 3);
+  }
+  return problem;
+}
+
+int main(void) {
+  // Initialise the library
+  csp_init();
+  {
+    // Four boards and two free variables
+    size_t sizes[] = {6, 8, 5, 7};
+    CSPProblem *problem = create(4, sizes, 2);
+    size_t n = csp_problem_get_num_domains(problem);
+    assert(csp_problem_get_num_threads(problem) == 1);
+    for (size_t threads = 0; threads <= 4; threads++) {
+      size_t *values = calloc(n, sizeof(size_t));
+      csp_problem_set_num_threads(problem, threads);
+      assert(csp_problem_get_num_threads(problem) == threads);
+      assert(csp_problem_solve(problem, values, NULL));
+      // The stitched solution satisfies all the constraints
+      assert(csp_problem_is_consistent(problem, values, NULL, n));
+      // It is the same solution as the one of the plain search
+      size_t *expected = calloc(n, sizeof(size_t));
+      assert(csp_problem_backtrack(problem, expected, NULL, 0));
+      for (size_t i = 0; i < n; i++) {
+        assert(values[i] == expected[i]);
+      }
+      free(expected);
+      free(values);
+    }
+    destroy(problem);
+  }
+  {
+    // A board without solution makes the whole problem unsolvable
+    size_t sizes[] = {8, 3, 6};
+    CSPProblem *problem = create(3, sizes, 1);
+    size_t *values = calloc(csp_problem_get_num_domains(problem),
+                            sizeof(size_t));
+    csp_problem_set_num_threads(problem, 2);
+    assert(!csp_problem_solve(problem, values, NULL));
+    csp_problem_set_num_threads(problem, 1);
+    assert(!csp_problem_solve(problem, values, NULL));
+    free(values);
+    destroy(problem);
+  }
+  {
+    // A free variable with an empty domain
+    size_t sizes[] = {4};
+    CSPProblem *problem = create(1, sizes, 1);
+    size_t values[5];
+    assert(csp_problem_solve(problem, values, NULL));
+    csp_problem_set_domain(problem, 4, 0);
+    assert(!csp_problem_solve(problem, values, NULL));
+    destroy(problem);
+  }
+  // Finish the library
+  csp_finish();
+
+  return EXIT_SUCCESS;
+}
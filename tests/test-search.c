@@ -0,0 +1,76 @@
+#include <stdlib.h>
+
+#include "csp.h"
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#include <assert.h>
+
+#include "problems.h"
+
+// Compare two assignments in lexicographic order
+static int compare(const size_t *a, const size_t *b, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    if (a[i] != b[i]) {
+      return a[i] < b[i] ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+int main(void) {
+  // Initialise the library
+  csp_init();
+  {
+    // Count the solutions of the n-queens problems
+    size_t expected[] = {0, 0, 2, 10, 4, 40, 92};
+    for (size_t n = 2; n <= 8; n++) {
+      CSPProblem *problem = create_queens(n);
+      CSPSearch *search = csp_search_begin(problem, NULL);
+      assert(search != NULL);
+      size_t values[8], previous[8];
+      size_t count = 0;
+      while (csp_search_next(search, values)) {
+        assert(csp_problem_is_consistent(problem, values, NULL, n));
+        // The solutions are yielded in lexicographic order
+        assert(!count || compare(previous, values, n) < 0);
+        if (!count) {
+          // The first one is the solution of the plain search
+          size_t first[8];
+          assert(csp_problem_backtrack(problem, first, NULL, 0));
+          assert(!compare(first, values, n));
+        }
+        for (size_t i = 0; i < n; i++) {
+          previous[i] = values[i];
+        }
+        count++;
+      }
+      assert(count == expected[n - 2]);
+      // The search stays finished
+      assert(!csp_search_next(search, values));
+      csp_search_end(search);
+      destroy(problem);
+    }
+  }
+  {
+    // Two interleaved searches on the same problem are independent
+    CSPProblem *problem = create_queens(6);
+    CSPSearch *a = csp_search_begin(problem, NULL);
+    CSPSearch *b = csp_search_begin(problem, NULL);
+    size_t va[6], vb[6];
+    assert(csp_search_next(a, va));
+    assert(csp_search_next(a, va));
+    assert(csp_search_next(b, vb));
+    assert(compare(vb, va, 6) < 0);
+    assert(csp_search_next(b, vb));
+    assert(!compare(vb, va, 6));
+    // A search can be ended before it is finished
+    csp_search_end(a);
+    csp_search_end(b);
+    destroy(problem);
+  }
+  // Finish the library
+  csp_finish();
+
+  return EXIT_SUCCESS;
+}